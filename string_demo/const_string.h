@@ -0,0 +1,483 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "string_hash.h"
+#include "string_kernels.h"
+#include "string_memory.h"
+#include "sso_string4.h"
+
+// Immutable string shared by reference counting, one pointer in size.
+// Up to 6 chars (2 on 32-bit builds) live in the handle itself:
+// the lowest byte is size * 2 + 1, chars and terminating zero follow.
+// Longer strings point to a header placed after the chars of the same buffer:
+//   [chars][0][padding][refcount, size, capacity]
+// so a heap buffer of a mutable string with spare capacity becomes
+// a shared string as it is, the chars are never moved, and the only owner
+// of a shared string gives the buffer back to a mutable string the same way.
+// The reference count is a policy: plain for strings that stay in one thread,
+// atomic for any use, biased for strings mostly copied by the thread that made them.
+// Slices are an offset and a size in the chars of a shared string they keep alive,
+// a slicing policy copies the chars instead when the slice would pin a much larger buffer.
+namespace shared {
+
+    using mutable_string = sso4::string;
+
+    // strings and all their copies are used by one thread
+    class local_refcount {
+        size_t _count;
+
+    public:
+        local_refcount() noexcept : _count(1) {}
+
+        void retain() noexcept {
+            ++_count;
+        }
+
+        // true if it was the last reference
+        bool release() noexcept {
+            return --_count == 0;
+        }
+
+        // exact if called by a holder of one of the references
+        size_t count() const noexcept {
+            return _count;
+        }
+    };
+
+    class atomic_refcount {
+        std::atomic<size_t> _count;
+
+    public:
+        atomic_refcount() noexcept : _count(1) {}
+
+        void retain() noexcept {
+            _count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bool release() noexcept {
+            return _count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        size_t count() const noexcept {
+            return _count.load(std::memory_order_acquire);
+        }
+    };
+
+    // The thread that made the string counts its copies without atomic operations,
+    // other threads count theirs with atomics in a second counter.
+    // Releases are atomic in any thread: the owner count only grows, so whoever
+    // takes the shared count to minus the owner count holds the last reference,
+    // and no handshake with the owner thread is needed.
+    class biased_refcount {
+        std::thread::id _owner;
+        std::atomic<size_t> _owner_count;       // written by the owner thread only
+        std::atomic<ptrdiff_t> _shared_count;   // copies by other threads minus all releases
+
+    public:
+        biased_refcount() noexcept : _owner(std::this_thread::get_id()), _owner_count(1), _shared_count(0) {}
+
+        void retain() noexcept {
+            if (std::this_thread::get_id() == _owner) {
+                // load and store, no lock prefix or exclusive monitor
+                _owner_count.store(_owner_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+            else {
+                _shared_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        bool release() noexcept {
+            // acquiring all earlier releases makes the copies released so far visible in the owner count
+            auto shared = _shared_count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+            return (ptrdiff_t)_owner_count.load(std::memory_order_relaxed) + shared == 0;
+        }
+
+        size_t count() const noexcept {
+            auto shared = _shared_count.load(std::memory_order_acquire);
+            return (size_t)((ptrdiff_t)_owner_count.load(std::memory_order_relaxed) + shared);
+        }
+    };
+
+    // Slices of at least MinSize chars share the parent buffer if it is
+    // at most MaxWasteRatio times larger than the slice, others get own copies.
+    // Slices short enough for the inline form are always copied.
+    template <size_t MinSize, size_t MaxWasteRatio>
+    struct slicing_threshold {
+        static bool share(size_t slice_size, size_t parent_size) noexcept {
+            return slice_size >= MinSize && parent_size / MaxWasteRatio <= slice_size;
+        }
+    };
+
+    using default_slicing = slicing_threshold<16, 4>;
+    using always_share = slicing_threshold<0, (size_t)-1>;
+    using never_share = slicing_threshold<(size_t)-1, 1>;
+
+    template <class RefCount>
+    class basic_const_string;
+
+    template <class RefCount>
+    class basic_string_slice;
+
+    template <class RefCount = atomic_refcount>
+    basic_const_string<RefCount> make_const(mutable_string&& str);
+
+    template <class RefCount>
+    class basic_const_string {
+
+        struct header {
+            RefCount _refs;
+            size_t _size;
+            size_t _capacity;   // of the whole buffer as memory::allocate got it
+
+            char* data() noexcept {
+                return reinterpret_cast<char*>(this) - header_offset(_size);
+            }
+        };
+
+        // header goes after the terminating zero aligned for its fields
+        static size_t header_offset(size_t size) noexcept {
+            return (size + 1 + alignof(header) - 1) & ~(alignof(header) - 1);
+        }
+
+        static bool has_room_for_header(size_t size, size_t capacity) noexcept {
+            return header_offset(size) + sizeof(header) <= capacity + 1;
+        }
+
+        union {
+            header* _header;
+            uintptr_t _word;
+            char _inline[sizeof(header*)];
+        };
+
+        bool is_inline() const noexcept {
+            return _inline[0] & 1;
+        }
+
+        void set_inline(const char* str, size_t size) noexcept {
+            assert(size <= INLINE_CAPACITY);
+            _word = 0;
+            _inline[0] = (char)(size * 2 + 1);
+            if (size > 0) {
+                std::memcpy(_inline + 1, str, size);
+            }
+        }
+
+        // the header is constructed in the buffer, chars and terminating zero are there already
+        void set_shared(char* data, size_t size, size_t capacity) noexcept {
+            assert(has_room_for_header(size, capacity));
+            _header = new (data + header_offset(size)) header{ {}, size, capacity };
+        }
+
+        void copy_from(const char* str, size_t size) {
+            if (size <= INLINE_CAPACITY) {
+                set_inline(str, size);
+                return;
+            }
+            // odd capacity lets mutable strings adopt the buffer later
+            auto capacity = memory::round_capacity((header_offset(size) + sizeof(header) - 1) | 1);
+            auto data = memory::allocate(capacity);
+            std::memcpy(data, str, size);
+            data[size] = 0;
+            set_shared(data, size, capacity);
+        }
+
+        void retain() const noexcept {
+            if (!is_inline()) {
+                _header->_refs.retain();
+            }
+        }
+
+        void release() noexcept {
+            if (!is_inline() && _header->_refs.release()) {
+                auto data = _header->data();
+                auto capacity = _header->_capacity;
+                _header->~header();
+                memory::deallocate(data, capacity);
+            }
+        }
+
+        // the buffer without the header if this handle is its only owner,
+        // the handle becomes empty then
+        mutable_string::heap_buffer release_unique_buffer() noexcept {
+            if (is_inline() || _header->_refs.count() != 1
+                || !mutable_string::can_adopt(_header->_capacity)) {
+                return mutable_string::heap_buffer{ nullptr, size(), 0 };
+            }
+            mutable_string::heap_buffer res{ _header->data(), _header->_size, _header->_capacity };
+            _header->~header();
+            set_inline(nullptr, 0);
+            return res;
+        }
+
+        template <class Policy>
+        friend basic_const_string<Policy> make_const(mutable_string&& str);
+        template <class Policy>
+        friend mutable_string make_mutable(basic_const_string<Policy>&& str);
+
+    public:
+        enum { INLINE_CAPACITY = sizeof(header*) - 2 };
+
+        // empty
+        basic_const_string() noexcept {
+            set_inline(nullptr, 0);
+        }
+
+        explicit basic_const_string(const char* str) {
+            copy_from(str, std::strlen(str));
+        }
+
+        basic_const_string(const char* str, size_t size) {
+            copy_from(str, size);
+        }
+
+        // copies share the chars
+        basic_const_string(const basic_const_string& other) noexcept : _word(other._word) {
+            retain();
+        }
+
+        basic_const_string(basic_const_string&& other) noexcept : _word(other._word) {
+            other.set_inline(nullptr, 0);
+        }
+
+        basic_const_string& operator=(const basic_const_string& other) noexcept {
+            other.retain();
+            release();
+            _word = other._word;
+            return *this;
+        }
+
+        basic_const_string& operator=(basic_const_string&& other) noexcept {
+            if (this != &other) {
+                release();
+                _word = other._word;
+                other.set_inline(nullptr, 0);
+            }
+            return *this;
+        }
+
+        ~basic_const_string() noexcept {
+            release();
+        }
+
+        void swap(basic_const_string& other) noexcept {
+            std::swap(_word, other._word);
+        }
+
+        const char* c_str() const noexcept {
+            return is_inline() ? _inline + 1 : _header->data();
+        }
+
+        size_t size() const noexcept {
+            return is_inline() ? (unsigned char)_inline[0] / 2 : _header->_size;
+        }
+
+        bool empty() const noexcept {
+            return size() == 0;
+        }
+
+        const char* begin() const noexcept {
+            return c_str();
+        }
+
+        const char* end() const noexcept {
+            return c_str() + size();
+        }
+
+        // number of handles sharing the chars, 1 for inline strings
+        size_t use_count() const noexcept {
+            return is_inline() ? 1 : _header->_refs.count();
+        }
+
+        size_t hash() const noexcept {
+            return hashing::hash32(c_str(), size());
+        }
+
+        // count chars from index or less if the string ends before,
+        // Slicing decides if the chars are shared or copied
+        template <class Slicing = default_slicing>
+        basic_string_slice<RefCount> slice(size_t index, size_t count) const {
+            assert(index <= size());
+            count = std::min(count, size() - index);
+            if (count <= INLINE_CAPACITY || !Slicing::share(count, size())) {
+                return basic_string_slice<RefCount>(basic_const_string(c_str() + index, count), 0, count);
+            }
+            return basic_string_slice<RefCount>(*this, index, count);
+        }
+
+        friend bool operator==(const basic_const_string& lhs, const basic_const_string& rhs) noexcept {
+            if (lhs._word == rhs._word) return true;
+            auto size = lhs.size();
+            return size == rhs.size() && kernels::equal(lhs.c_str(), rhs.c_str(), size);
+        }
+        friend bool operator!=(const basic_const_string& lhs, const basic_const_string& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+    };
+
+    using const_string = basic_const_string<atomic_refcount>;
+    using local_const_string = basic_const_string<local_refcount>;
+    using biased_const_string = basic_const_string<biased_refcount>;
+
+    // chars of a shared string, not zero terminated
+    template <class RefCount>
+    class basic_string_slice {
+        basic_const_string<RefCount> _owner;
+        size_t _offset;
+        size_t _size;
+
+    public:
+        // empty
+        basic_string_slice() noexcept : _offset(0), _size(0) {}
+
+        basic_string_slice(basic_const_string<RefCount> owner, size_t offset, size_t size) noexcept
+            : _owner(std::move(owner)), _offset(offset), _size(size) {
+            assert(offset + size <= _owner.size());
+        }
+
+        // inline chars move with the owner handle, so the address is taken each time
+        const char* data() const noexcept {
+            return _owner.c_str() + _offset;
+        }
+
+        size_t size() const noexcept {
+            return _size;
+        }
+
+        bool empty() const noexcept {
+            return _size == 0;
+        }
+
+        const char* begin() const noexcept {
+            return data();
+        }
+
+        const char* end() const noexcept {
+            return data() + _size;
+        }
+
+        // the string whose chars are viewed, may be this slice's own copy
+        const basic_const_string<RefCount>& owner() const noexcept {
+            return _owner;
+        }
+
+        // Slicing is applied to the owner, slices of slices never chain
+        template <class Slicing = default_slicing>
+        basic_string_slice slice(size_t index, size_t count) const {
+            assert(index <= _size);
+            count = std::min(count, _size - index);
+            return _owner.template slice<Slicing>(_offset + index, count);
+        }
+
+        // the chars as a string of their own, the owner itself if the slice covers it
+        basic_const_string<RefCount> to_const() const {
+            if (_size == _owner.size()) return _owner;
+            return basic_const_string<RefCount>(data(), _size);
+        }
+
+        size_t hash() const noexcept {
+            return hashing::hash32(data(), _size);
+        }
+
+        friend bool operator==(const basic_string_slice& lhs, const basic_string_slice& rhs) noexcept {
+            return lhs._size == rhs._size && kernels::equal(lhs.data(), rhs.data(), lhs._size);
+        }
+        friend bool operator!=(const basic_string_slice& lhs, const basic_string_slice& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+
+        template <class Policy>
+        friend mutable_string make_mutable(basic_string_slice<Policy>&& str);
+    };
+
+    using string_slice = basic_string_slice<atomic_refcount>;
+    using local_string_slice = basic_string_slice<local_refcount>;
+    using biased_string_slice = basic_string_slice<biased_refcount>;
+
+    // takes the heap buffer of str if it has room for the header after the chars,
+    // copies otherwise, str is left empty
+    template <class RefCount>
+    inline basic_const_string<RefCount> make_const(mutable_string&& str) {
+        basic_const_string<RefCount> res;
+        auto size = str.size();
+        if (size > basic_const_string<RefCount>::INLINE_CAPACITY) {
+            auto buffer = str.release_heap_buffer();
+            if (buffer.data && basic_const_string<RefCount>::has_room_for_header(buffer.size, buffer.capacity)) {
+                res.set_shared(buffer.data, buffer.size, buffer.capacity);
+                return res;
+            }
+            if (buffer.data) {
+                // give the buffer back to be freed by its owner after copying
+                str = mutable_string::adopt_heap_buffer(buffer);
+            }
+        }
+        res.copy_from(str.c_str(), size);
+        str = mutable_string();
+        return res;
+    }
+
+    // the chars are copied
+    template <class RefCount>
+    inline mutable_string make_mutable(const basic_const_string<RefCount>& str) {
+        mutable_string res;
+        res.resize(str.size());
+        std::memcpy(res.begin(), str.c_str(), str.size());
+        return res;
+    }
+
+    // takes the buffer if str is its only owner, copies otherwise, str is left empty
+    template <class RefCount>
+    inline mutable_string make_mutable(basic_const_string<RefCount>&& str) {
+        auto buffer = str.release_unique_buffer();
+        if (buffer.data) return mutable_string::adopt_heap_buffer(buffer);
+        auto res = make_mutable(static_cast<const basic_const_string<RefCount>&>(str));
+        str = basic_const_string<RefCount>();
+        return res;
+    }
+
+    // mutating a slice needs a copy of its chars
+    template <class RefCount>
+    inline mutable_string make_mutable(const basic_string_slice<RefCount>& str) {
+        mutable_string res;
+        res.resize(str.size());
+        std::memcpy(res.begin(), str.data(), str.size());
+        return res;
+    }
+
+    // a slice covering its owner takes the buffer like the owner would, str is left empty
+    template <class RefCount>
+    inline mutable_string make_mutable(basic_string_slice<RefCount>&& str) {
+        if (str._size == str._owner.size()) {
+            str._size = 0;
+            return make_mutable(std::move(str._owner));
+        }
+        auto res = make_mutable(static_cast<const basic_string_slice<RefCount>&>(str));
+        str = basic_string_slice<RefCount>();
+        return res;
+    }
+}
+
+namespace std {
+    template <class RefCount>
+    struct hash<shared::basic_const_string<RefCount>> {
+        size_t operator()(const shared::basic_const_string<RefCount>& str) const noexcept {
+            return str.hash();
+        }
+    };
+
+    template <class RefCount>
+    struct hash<shared::basic_string_slice<RefCount>> {
+        size_t operator()(const shared::basic_string_slice<RefCount>& str) const noexcept {
+            return str.hash();
+        }
+    };
+}
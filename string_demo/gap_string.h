@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <cassert>
+
+namespace gap {
+
+    // Gap buffer keeps free space (the gap) at the last edit position:
+    //
+    //   hello, _________world
+    //          ^        ^
+    //          gap_begin gap_end
+    //
+    // Sequential inserts near the same position only fill the gap,
+    // text is moved only when the edit position changes and only
+    // the part between the old and the new position is moved.
+    // c_str() and begin() move the gap to the end to get contiguous text.
+    class string {
+        // gap position is mutable because c_str() moves the gap
+        mutable char* _data = nullptr;
+        mutable size_t _gap_begin = 0;
+        mutable size_t _gap_end = 0;
+        size_t _capacity = 0;
+
+        size_t gap_size() const noexcept {
+            return _gap_end - _gap_begin;
+        }
+
+        size_t calc_capacity(size_t required_size) const {
+            if (required_size <= _capacity) return _capacity;
+            size_t res = 16u;
+            while (res < required_size + 1) {
+                res *= 2; // run over powers of two
+            }
+            return res - 1;
+        }
+
+        void move_gap(size_t index) const noexcept {
+            assert(index <= size());
+            if (index < _gap_begin) {
+                // abc___def -> a___bcdef
+                auto count = _gap_begin - index;
+                std::memmove(_data + _gap_end - count, _data + index, count);
+                _gap_begin -= count;
+                _gap_end -= count;
+            }
+            else if (index > _gap_begin) {
+                // abc___def -> abcde___f
+                auto count = index - _gap_begin;
+                std::memmove(_data + _gap_begin, _data + _gap_end, count);
+                _gap_begin += count;
+                _gap_end += count;
+            }
+        }
+
+        // reallocates buffer and places the gap at index
+        void grow(size_t new_capacity, size_t index) {
+            auto size = this->size();
+            auto new_data = new char[new_capacity + 1];
+            auto new_gap_end = new_capacity - (size - index);
+            if (_data) {
+                if (index <= _gap_begin) {
+                    std::memcpy(new_data, _data, index);
+                    std::memcpy(new_data + new_gap_end, _data + index, _gap_begin - index);
+                    std::memcpy(new_data + new_gap_end + _gap_begin - index, _data + _gap_end, _capacity - _gap_end);
+                }
+                else {
+                    std::memcpy(new_data, _data, _gap_begin);
+                    std::memcpy(new_data + _gap_begin, _data + _gap_end, index - _gap_begin);
+                    std::memcpy(new_data + new_gap_end, _data + _gap_end + index - _gap_begin, _capacity - _gap_end - (index - _gap_begin));
+                }
+                delete[] _data;
+            }
+            new_data[new_capacity] = 0;
+            _data = new_data;
+            _gap_begin = index;
+            _gap_end = new_gap_end;
+            _capacity = new_capacity;
+        }
+
+        // makes room for count chars at index, the room is [_gap_begin, _gap_begin + count)
+        void open_gap(size_t index, size_t count) {
+            if (gap_size() < count) {
+                grow(calc_capacity(size() + count), index);
+            }
+            else {
+                move_gap(index);
+            }
+        }
+
+        void make_contiguous() const noexcept {
+            if (_data) {
+                move_gap(size());
+                _data[_gap_begin] = 0;
+            }
+        }
+
+    public:
+        // default constructed
+        string() noexcept = default;
+        // construct from c-string
+        explicit string(const char* str) {
+            assert(str);
+            auto size = std::strlen(str);
+            if (size > 0) {
+                _data = new char[size + 1];
+                std::memcpy(_data, str, size + 1);
+                _gap_begin = _gap_end = _capacity = size;
+            }
+        }
+
+        // rule of five
+        string(const string& other) {
+            auto size = other.size();
+            if (size > 0) {
+                _data = new char[size + 1];
+                std::memcpy(_data, other._data, other._gap_begin);
+                std::memcpy(_data + other._gap_begin, other._data + other._gap_end, other._capacity - other._gap_end);
+                _data[size] = 0;
+                _gap_begin = _gap_end = _capacity = size;
+            }
+        }
+        string(string&& other) noexcept :
+            _data(other._data),
+            _gap_begin(other._gap_begin),
+            _gap_end(other._gap_end),
+            _capacity(other._capacity) {
+            other._data = nullptr;
+            other._gap_begin = other._gap_end = other._capacity = 0;
+        }
+        string& operator=(const string& other) {
+            if (this == &other) return *this;
+            string tmp(other);
+            swap(tmp);
+            return *this;
+        }
+        string& operator=(string&& other) noexcept {
+            if (this == &other) return *this;
+            delete[] _data;
+            _data = other._data;
+            _gap_begin = other._gap_begin;
+            _gap_end = other._gap_end;
+            _capacity = other._capacity;
+            other._data = nullptr;
+            other._gap_begin = other._gap_end = other._capacity = 0;
+            return *this;
+        }
+        ~string() noexcept {
+            delete[] _data;
+        }
+
+        // useful and interesting
+        void swap(string& other) noexcept {
+            std::swap(_data, other._data);
+            std::swap(_gap_begin, other._gap_begin);
+            std::swap(_gap_end, other._gap_end);
+            std::swap(_capacity, other._capacity);
+        }
+
+        // iterators, both make the text contiguous
+        char* begin() noexcept {
+            make_contiguous();
+            return _data;
+        }
+        char* end() noexcept {
+            return begin() + size();
+        }
+
+        // some modifications to have fun
+        void insert(size_t index, size_t count, char ch) {
+            if (count == 0) return;
+            open_gap(index, count);
+            std::memset(_data + _gap_begin, ch, count);
+            _gap_begin += count;
+        }
+        void insert(size_t index, const char* str) {
+            auto count = std::strlen(str);
+            if (count == 0) return;
+            if (_data && str >= _data && str < _data + _capacity) {
+                // str points into this string, remember its logical position
+                // because the text is going to be moved
+                size_t pos = str - _data;
+                if (pos >= _gap_end) pos -= gap_size();
+                open_gap(index, count);
+                auto dst = _data + _gap_begin;
+                if (pos < index) {
+                    auto first_part = std::min(count, index - pos);
+                    std::memcpy(dst, _data + pos, first_part);
+                    dst += first_part;
+                    pos += first_part;
+                    count -= first_part;
+                }
+                std::memcpy(dst, _data + pos + gap_size(), count);
+                _gap_begin = dst + count - _data;
+            }
+            else {
+                open_gap(index, count);
+                std::memcpy(_data + _gap_begin, str, count);
+                _gap_begin += count;
+            }
+        }
+
+        // for printing
+        const char* c_str() const noexcept {
+            make_contiguous();
+            return _data ? _data : "";
+        }
+
+        size_t size() const noexcept {
+            return _capacity - gap_size();
+        }
+        void resize(size_t new_size, char ch = 0) {
+            auto size = this->size();
+            if (new_size > size) {
+                insert(size, new_size - size, ch);
+            }
+            else if (new_size <= _gap_begin) {
+                // drop everything after the gap
+                _gap_begin = new_size;
+                _gap_end = _capacity;
+            }
+            else if (new_size < size) {
+                // keep the head of the text after the gap, move it to the end
+                auto keep = new_size - _gap_begin;
+                std::memmove(_data + _capacity - keep, _data + _gap_end, keep);
+                _gap_end = _capacity - keep;
+            }
+        }
+
+        size_t capacity() const noexcept {
+            return _capacity;
+        }
+        void reserve(size_t new_capacity) {
+            if (new_capacity > _capacity) {
+                grow(new_capacity, _gap_begin);
+            }
+        }
+    };
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "sso_string3.h"
+
+namespace rope {
+
+    // contiguous part of the text
+    struct chunk {
+        const char* data;
+        size_t size;
+    };
+
+    // Piece table for big documents.
+    // Text is a sequence of pieces kept in a treap ordered by position,
+    // every node knows the length of its subtree, so any position
+    // is found in O(log n) and insert/erase are split + merge.
+    // Pieces never copy text they refer to:
+    //  - inserted text is appended to a shared add buffer,
+    //  - insert_view refers to memory owned by somebody else,
+    //  - substr and insert(index, const string&) share the buffers.
+    class string {
+        enum { ADD_BUFFER_BLOCK_SIZE = 4096 };
+
+        struct node {
+            std::shared_ptr<const char> buffer; // keeps data alive, empty for views
+            const char* data;
+            size_t length;
+            size_t subtree_length;
+            unsigned priority;
+            std::unique_ptr<node> left;
+            std::unique_ptr<node> right;
+        };
+        using node_ptr = std::unique_ptr<node>;
+
+        node_ptr _root;
+        // add buffer is append-only, text written there never moves
+        std::shared_ptr<char> _add_buffer;
+        size_t _add_buffer_used = 0;
+        size_t _add_buffer_capacity = 0;
+        unsigned _seed = 2463534242u;
+
+        static size_t length(const node_ptr& t) noexcept {
+            return t ? t->subtree_length : 0;
+        }
+
+        static void update(node* t) noexcept {
+            t->subtree_length = length(t->left) + t->length + length(t->right);
+        }
+
+        unsigned next_priority() noexcept {
+            // xorshift32
+            _seed ^= _seed << 13;
+            _seed ^= _seed >> 17;
+            _seed ^= _seed << 5;
+            return _seed;
+        }
+
+        node_ptr make_node(std::shared_ptr<const char> buffer, const char* data, size_t length) {
+            assert(length > 0);
+            node_ptr res(new node{ std::move(buffer), data, length, length, next_priority(), nullptr, nullptr });
+            return res;
+        }
+
+        static node_ptr merge(node_ptr a, node_ptr b) {
+            if (!a) return b;
+            if (!b) return a;
+            if (a->priority > b->priority) {
+                a->right = merge(std::move(a->right), std::move(b));
+                update(a.get());
+                return a;
+            }
+            else {
+                b->left = merge(std::move(a), std::move(b->left));
+                update(b.get());
+                return b;
+            }
+        }
+
+        // splits t into [0, index) and [index, length(t))
+        std::pair<node_ptr, node_ptr> split(node_ptr t, size_t index) {
+            if (!t) return {};
+            auto left_length = length(t->left);
+            if (index <= left_length) {
+                auto parts = split(std::move(t->left), index);
+                t->left = std::move(parts.second);
+                update(t.get());
+                return { std::move(parts.first), std::move(t) };
+            }
+            if (index >= left_length + t->length) {
+                auto parts = split(std::move(t->right), index - left_length - t->length);
+                t->right = std::move(parts.first);
+                update(t.get());
+                return { std::move(t), std::move(parts.second) };
+            }
+            // split the piece itself, both halves share the buffer
+            auto offset = index - left_length;
+            auto tail = make_node(t->buffer, t->data + offset, t->length - offset);
+            t->length = offset;
+            auto right = merge(std::move(tail), std::move(t->right));
+            update(t.get());
+            return { std::move(t), std::move(right) };
+        }
+
+        void insert_tree(size_t index, node_ptr tree) {
+            assert(index <= size());
+            auto parts = split(std::move(_root), index);
+            _root = merge(merge(std::move(parts.first), std::move(tree)), std::move(parts.second));
+        }
+
+        // reserves count chars in the add buffer
+        char* allocate(size_t count) {
+            if (_add_buffer_capacity - _add_buffer_used < count) {
+                auto new_capacity = count < ADD_BUFFER_BLOCK_SIZE ? (size_t)ADD_BUFFER_BLOCK_SIZE : count;
+                _add_buffer.reset(new char[new_capacity], std::default_delete<char[]>());
+                _add_buffer_used = 0;
+                _add_buffer_capacity = new_capacity;
+            }
+            auto res = _add_buffer.get() + _add_buffer_used;
+            _add_buffer_used += count;
+            return res;
+        }
+
+        // builds a tree of pieces of t in range [index, index + count)
+        void copy_range(const node* t, size_t index, size_t count, node_ptr& out) {
+            if (!t || count == 0) return;
+            auto left_length = length(t->left);
+            if (index < left_length) {
+                copy_range(t->left.get(), index, count, out);
+            }
+            auto begin = std::max(index, left_length);
+            auto end = std::min(index + count, left_length + t->length);
+            if (begin < end) {
+                out = merge(std::move(out), make_node(t->buffer, t->data + (begin - left_length), end - begin));
+            }
+            if (index + count > left_length + t->length) {
+                auto right_start = left_length + t->length;
+                auto right_index = index > right_start ? index - right_start : 0;
+                copy_range(t->right.get(), right_index, index + count - right_start - right_index, out);
+            }
+        }
+
+        static char* copy_to(const node* t, char* dst) noexcept {
+            if (!t) return dst;
+            dst = copy_to(t->left.get(), dst);
+            std::memcpy(dst, t->data, t->length);
+            return copy_to(t->right.get(), dst + t->length);
+        }
+
+        node_ptr clone(const node_ptr& t) const {
+            if (!t) return nullptr;
+            node_ptr res(new node{ t->buffer, t->data, t->length, t->subtree_length, t->priority, clone(t->left), clone(t->right) });
+            return res;
+        }
+
+    public:
+        // walks chunks of the text in order
+        class chunk_iterator {
+            std::vector<const node*> _path;
+
+            void push_left(const node* t) {
+                for (; t; t = t->left.get()) {
+                    _path.push_back(t);
+                }
+            }
+
+        public:
+            chunk_iterator() = default;
+            explicit chunk_iterator(const node* root) {
+                push_left(root);
+            }
+            chunk operator*() const {
+                return { _path.back()->data, _path.back()->length };
+            }
+            chunk_iterator& operator++() {
+                auto t = _path.back();
+                _path.pop_back();
+                push_left(t->right.get());
+                return *this;
+            }
+            bool operator==(const chunk_iterator& other) const {
+                return _path.empty() ? other._path.empty()
+                    : !other._path.empty() && _path.back() == other._path.back();
+            }
+            bool operator!=(const chunk_iterator& other) const {
+                return !(*this == other);
+            }
+        };
+
+        struct chunk_range {
+            chunk_iterator _begin;
+            chunk_iterator begin() const { return _begin; }
+            chunk_iterator end() const { return {}; }
+        };
+
+        // default constructed
+        string() noexcept = default;
+        // construct from c-string
+        explicit string(const char* str) {
+            insert(0, str);
+        }
+
+        // rule of five, copy shares the pieces but not the add buffer
+        string(const string& other) :
+            _root(clone(other._root)) {
+        }
+        string(string&& other) noexcept = default;
+        string& operator=(const string& other) {
+            if (this == &other) return *this;
+            _root = clone(other._root);
+            return *this;
+        }
+        string& operator=(string&& other) noexcept = default;
+        ~string() noexcept = default;
+
+        void swap(string& other) noexcept {
+            std::swap(_root, other._root);
+            std::swap(_add_buffer, other._add_buffer);
+            std::swap(_add_buffer_used, other._add_buffer_used);
+            std::swap(_add_buffer_capacity, other._add_buffer_capacity);
+            std::swap(_seed, other._seed);
+        }
+
+        // modifications, all of them are O(log n) in number of pieces
+        void insert(size_t index, size_t count, char ch) {
+            if (count == 0) return;
+            auto data = allocate(count);
+            std::memset(data, ch, count);
+            insert_tree(index, make_node(_add_buffer, data, count));
+        }
+        void insert(size_t index, const char* str) {
+            auto count = std::strlen(str);
+            if (count == 0) return;
+            auto data = allocate(count);
+            std::memcpy(data, str, count);
+            insert_tree(index, make_node(_add_buffer, data, count));
+        }
+        // inserts other without copying the text
+        void insert(size_t index, const string& other) {
+            node_ptr tree;
+            copy_range(other._root.get(), 0, other.size(), tree);
+            insert_tree(index, std::move(tree));
+        }
+        // inserts a piece referring to external memory,
+        // [data, data + count) must outlive this string and stay unchanged
+        void insert_view(size_t index, const char* data, size_t count) {
+            if (count == 0) return;
+            insert_tree(index, make_node(nullptr, data, count));
+        }
+        void insert_view(size_t index, const sso3::string& str) {
+            insert_view(index, str.c_str(), str.size());
+        }
+
+        void erase(size_t index, size_t count) {
+            assert(index <= size());
+            auto parts = split(std::move(_root), index);
+            auto tail = split(std::move(parts.second), count);
+            _root = merge(std::move(parts.first), std::move(tail.second));
+        }
+
+        // zero-copy substring, pieces share buffers with this string
+        string substr(size_t index, size_t count) const {
+            assert(index <= size());
+            string res;
+            count = std::min(count, size() - index);
+            res.copy_range(_root.get(), index, count, res._root);
+            return res;
+        }
+
+        chunk_range chunks() const {
+            return { chunk_iterator(_root.get()) };
+        }
+
+        size_t size() const noexcept {
+            return length(_root);
+        }
+
+        // copies the whole text into a contiguous string
+        sso3::string flatten() const {
+            sso3::string res;
+            res.resize(size());
+            copy_to(_root.get(), res.begin());
+            return res;
+        }
+    };
+}
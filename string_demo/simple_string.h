@@ -1,7 +1,21 @@
+#include <algorithm>
 #include <cstring>
 #include <utility>
+#include <functional>
 #include <cassert>
 
+#include "string_algorithms.h"
+#include "string_case.h"
+#include "string_edit_distance.h"
+#include "string_format.h"
+#include "string_hash.h"
+#include "string_kernels.h"
+#include "string_memory.h"
+#include "string_parse.h"
+#include "string_search.h"
+#include "string_split.h"
+#include "string_utf8.h"
+
 #pragma once
 
 namespace simple {
@@ -11,6 +25,14 @@ namespace simple {
         size_t _size = 0;
         size_t _capacity = 0;
 
+        // keeps the text and terminating zero, large buffers are not copied
+        void grow(size_t new_capacity) {
+            new_capacity = memory::round_capacity(new_capacity);
+            _buffer = memory::reallocate(_buffer, _size, _capacity, new_capacity);
+            _buffer[_size] = '\0';
+            _capacity = new_capacity;
+        }
+
     public:
         // default constructed
         string() noexcept = default;
@@ -19,22 +41,22 @@ namespace simple {
         {
             assert(str);
             auto size = std::strlen(str);
-            _buffer = new char[size + 1];
+            _capacity = memory::round_capacity(size);
+            _buffer = memory::allocate(_capacity);
             std::memcpy(_buffer, str, size);
             _buffer[size] = '\0';
             _size = size;
-            _capacity = size;
         }
 
         // rule of five
         string(const string& other) {
             auto size = other.size();
             if (size > 0) {
-                _buffer = new char[size + 1];
+                _capacity = memory::round_capacity(size);
+                _buffer = memory::allocate(_capacity);
                 std::memcpy(_buffer, other._buffer, size);
                 _buffer[size] = '\0';
                 _size = size;
-                _capacity = size;
             }
             else {
                 _buffer = nullptr;
@@ -54,10 +76,11 @@ namespace simple {
             if (this == &other) return *this;
             auto size = other.size();
             if (_capacity < size) {
-                auto new_buffer = new char[size + 1];
-                delete[] _buffer;
+                auto new_capacity = memory::round_capacity(size);
+                auto new_buffer = memory::allocate(new_capacity);
+                memory::deallocate(_buffer, _capacity);
                 _buffer = new_buffer;
-                _capacity = size;
+                _capacity = new_capacity;
                 std::memcpy(_buffer, other._buffer, size);
                 _buffer[size] = '\0';
                 _size = size;
@@ -75,7 +98,7 @@ namespace simple {
         }
         string& operator=(string&& other) noexcept {
             if (this == &other) return *this;
-            delete[] _buffer;
+            memory::deallocate(_buffer, _capacity);
             _buffer = other._buffer;
             _size = other._size;
             _capacity = other._capacity;
@@ -85,7 +108,7 @@ namespace simple {
             return*this;
         }
         ~string() noexcept {
-            delete[] _buffer;
+            memory::deallocate(_buffer, _capacity);
         }
 
         // useful and interesting
@@ -106,42 +129,31 @@ namespace simple {
         // some modifications to have fun
         void insert(size_t index, size_t count, char ch) {
             if (_capacity < _size + count) {
-                _capacity = _size + count;
-                auto new_data = new char[_capacity + 1];
-                std::memcpy(new_data, _buffer, index);
-                std::memset(new_data + index, ch, count);
-                std::memcpy(new_data + _size, _buffer + index, _size + 1 - index);
-                delete _buffer;
-                _buffer = new_data;
-                _size += count;
+                grow(_size + count);
             }
-            else if (count > 0) {
-                std::memmove(_buffer + index + count, _buffer + index, _size + 1 - index);
-                std::memset(_buffer + index, ch, count);
+            if (count > 0) {
+                kernels::move(_buffer + index + count, _buffer + index, _size + 1 - index);
+                kernels::fill(_buffer + index, ch, count);
                 _size += count;
             }
         }
         void insert(size_t index, const char* str) {
             auto count = std::strlen(str);
             if (_capacity < _size + count) {
-                _capacity = _size + count;
-                auto new_data = new char[_capacity + 1];
-                std::memcpy(new_data, _buffer, index);
-                std::memcpy(new_data + index, str, count);
-                std::memcpy(new_data + index + count, _buffer + index, _size - index);
-                new_data[_size + count] = 0;
-                delete _buffer;
-                _buffer = new_data;
-                _size += count;
+                // str may point into the buffer that is going to be moved
+                auto inside = algorithms::points_into(str, _buffer, _size);
+                auto offset = inside ? str - _buffer : 0;
+                grow(_size + count);
+                if (inside) str = _buffer + offset;
             }
-            else if (_buffer) {
-                std::memmove(_buffer + index + count, _buffer + index, _size + 1 - index);
+            if (count > 0) {
+                kernels::move(_buffer + index + count, _buffer + index, _size + 1 - index);
                 if (str + count >= _buffer + index && str + count <= _buffer + _size) {
                     // some data pointed by str was moved with memmove
                     if (str < _buffer + index) {
-                        auto first_part = _buffer + index - str;
+                        auto first_part = std::min((size_t)(_buffer + index - str), count);
                         // copy the first part that was not moved
-                        std::memcpy(_buffer + index, str, first_part);
+                        kernels::copy(_buffer + index, str, first_part);
                         index += first_part;
                         str += count + first_part;
                         count -= first_part;
@@ -150,11 +162,206 @@ namespace simple {
                         str += count;
                     }
                 }
-                std::memcpy(_buffer + index, str, count);
+                kernels::copy(_buffer + index, str, count);
                 _size += count;
             }
         }
 
+        void erase(size_t index, size_t count) {
+            assert(index <= _size);
+            count = std::min(count, _size - index);
+            if (count > 0) {
+                kernels::move(_buffer + index, _buffer + index + count, _size + 1 - index - count);
+                _size -= count;
+            }
+        }
+        void replace(size_t index, size_t count, const char* str) {
+            assert(index <= _size);
+            count = std::min(count, _size - index);
+            auto str_size = std::strlen(str);
+            auto new_size = _size - count + str_size;
+            if (_capacity < new_size || algorithms::points_into(str, _buffer, _size)) {
+                // old buffer is kept until the copy is done, so str may point into it
+                auto new_capacity = memory::round_capacity(new_size);
+                auto new_data = memory::allocate(new_capacity);
+                kernels::copy(new_data, _buffer, index);
+                kernels::copy(new_data + index, str, str_size);
+                kernels::copy(new_data + index + str_size, _buffer + index + count, _size - index - count);
+                new_data[new_size] = 0;
+                memory::deallocate(_buffer, _capacity);
+                _buffer = new_data;
+                _size = new_size;
+                _capacity = new_capacity;
+            }
+            else if (_buffer) {
+                kernels::move(_buffer + index + str_size, _buffer + index + count, _size + 1 - index - count);
+                kernels::copy(_buffer + index, str, str_size);
+                _size = new_size;
+            }
+        }
+        // counts matches first, so the result is written in one pass with at most one allocation
+        void replace_all(const char* pattern, const char* replacement) {
+            auto pattern_size = std::strlen(pattern);
+            auto replacement_size = std::strlen(replacement);
+            auto count = algorithms::count(_buffer, _size, pattern, pattern_size);
+            if (count == 0) return;
+            auto new_size = _size - count * pattern_size + count * replacement_size;
+            if (_capacity < new_size
+                || algorithms::points_into(pattern, _buffer, _size)
+                || algorithms::points_into(replacement, _buffer, _size)) {
+                auto new_capacity = memory::round_capacity(new_size);
+                auto new_data = memory::allocate(new_capacity);
+                algorithms::replace_all(new_data, _buffer, _size, pattern, pattern_size, replacement, replacement_size);
+                new_data[new_size] = 0;
+                memory::deallocate(_buffer, _capacity);
+                _buffer = new_data;
+                _size = new_size;
+                _capacity = new_capacity;
+            }
+            else {
+                // growing result is written from the start while the text is read from the end
+                auto src = _buffer;
+                if (new_size > _size) {
+                    src = _buffer + _capacity - _size;
+                    kernels::move(src, _buffer, _size);
+                }
+                algorithms::replace_all(_buffer, src, _size, pattern, pattern_size, replacement, replacement_size);
+                _buffer[new_size] = 0;
+                _size = new_size;
+            }
+        }
+
+        // search, returns search::npos if nothing is found
+        size_t find(char ch, size_t pos = 0) const noexcept {
+            return search::find(_buffer, _size, ch, pos);
+        }
+        size_t find(const char* str, size_t pos = 0) const noexcept {
+            return search::find(_buffer, _size, str, std::strlen(str), pos);
+        }
+        size_t rfind(char ch, size_t pos = search::npos) const noexcept {
+            return search::rfind(_buffer, _size, ch, pos);
+        }
+        size_t rfind(const char* str, size_t pos = search::npos) const noexcept {
+            return search::rfind(_buffer, _size, str, std::strlen(str), pos);
+        }
+        size_t find_first_of(const char* chars, size_t pos = 0) const noexcept {
+            return search::find_first_of(_buffer, _size, chars, std::strlen(chars), pos);
+        }
+        size_t find_first_not_of(const char* chars, size_t pos = 0) const noexcept {
+            return search::find_first_not_of(_buffer, _size, chars, std::strlen(chars), pos);
+        }
+
+        // comparison, sizes are checked before any char is read
+        int compare(const string& other) const noexcept {
+            auto size = this->size();
+            auto other_size = other.size();
+            auto res = kernels::compare(_buffer, other._buffer, std::min(size, other_size));
+            if (res != 0) return res;
+            return size < other_size ? -1 : size > other_size;
+        }
+        friend bool operator==(const string& lhs, const string& rhs) noexcept {
+            auto size = lhs.size();
+            return size == rhs.size() && kernels::equal(lhs._buffer, rhs._buffer, size);
+        }
+        friend bool operator!=(const string& lhs, const string& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+        friend bool operator<(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) < 0;
+        }
+        friend bool operator<=(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) <= 0;
+        }
+        friend bool operator>(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) > 0;
+        }
+        friend bool operator>=(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) >= 0;
+        }
+
+        // ASCII case conversion, other chars are kept
+        void to_lower() noexcept {
+            ascii::to_lower(_buffer, _size);
+        }
+        void to_upper() noexcept {
+            ascii::to_upper(_buffer, _size);
+        }
+
+        // ASCII case-insensitive comparison and matching hash
+        bool iequals(const string& other) const noexcept {
+            auto size = this->size();
+            return size == other.size() && ascii::iequal(_buffer, other._buffer, size);
+        }
+        int icompare(const string& other) const noexcept {
+            auto size = this->size();
+            auto other_size = other.size();
+            auto res = ascii::icompare(_buffer, other._buffer, std::min(size, other_size));
+            if (res != 0) return res;
+            return size < other_size ? -1 : size > other_size;
+        }
+        size_t ihash() const noexcept {
+            return ascii::ihash32(_buffer, size());
+        }
+
+        // 32-bit hash of the chars
+        size_t hash() const noexcept {
+            return hashing::hash32(_buffer, _size);
+        }
+
+        // UTF-8 checks
+        bool validate_utf8() const noexcept {
+            return utf8::validate(_buffer, _size);
+        }
+        size_t count_code_points() const noexcept {
+            return utf8::count_code_points(_buffer, _size);
+        }
+
+        // Levenshtein distance, the bounded one gives up early
+        // and returns max_distance + 1 for farther strings
+        size_t edit_distance(const string& other) const {
+            return levenshtein::distance(c_str(), size(), other.c_str(), other.size());
+        }
+        size_t bounded_edit_distance(const string& other, size_t max_distance) const {
+            return levenshtein::distance(c_str(), size(), other.c_str(), other.size(), max_distance);
+        }
+
+        // zero-copy tokens, valid until the string is modified
+        splitting::range<splitting::char_delimiter> split(char delimiter) const noexcept {
+            return splitting::by_char(c_str(), size(), delimiter);
+        }
+        splitting::range<splitting::substring_delimiter> split(const char* delimiter) const noexcept {
+            return splitting::by_substring(c_str(), size(), delimiter);
+        }
+        splitting::range<splitting::any_of_delimiter> split_any_of(const char* delimiters) const noexcept {
+            return splitting::by_any_of(c_str(), size(), delimiters);
+        }
+
+        // numbers in the shortest form that reads back the same,
+        // no allocations while the result fits the inline buffer
+        template <class Number>
+        static string from_number(Number value) {
+            char buffer[numbers::MAX_CHARS + 1];
+            buffer[numbers::format(buffer, value)] = 0;
+            return string(buffer);
+        }
+        template <class Number>
+        void append_number(Number value) {
+            char buffer[numbers::MAX_CHARS + 1];
+            buffer[numbers::format(buffer, value)] = 0;
+            insert(size(), buffer);
+        }
+
+        // the whole string must be a number, value is kept on errors
+        numbers::parse_error parse_int(int64_t& value) const noexcept {
+            return numbers::parse_int(c_str(), size(), value);
+        }
+        numbers::parse_error parse_uint(uint64_t& value) const noexcept {
+            return numbers::parse_uint(c_str(), size(), value);
+        }
+        numbers::parse_error parse_double(double& value) const {
+            return numbers::parse_double(c_str(), size(), value);
+        }
+
         // for printing
         const char* c_str() const noexcept {
             return _buffer ? _buffer : "";
@@ -165,21 +372,14 @@ namespace simple {
         }
         void resize(size_t new_size, char ch = 0) {
             if (_capacity < new_size) {
-                auto new_data = new char[new_size + 1];
-                std::memcpy(new_data, _buffer, _size);
-                delete _buffer;
-                _buffer = new_data;
-                std::memset(_buffer + _size, ch, new_size - _size);
-                _buffer[new_size] = 0;
-                _size = new_size;
-                _capacity = new_size;
+                grow(new_size);
             }
-            else if (new_size < _size) {
+            if (new_size < _size) {
                 _buffer[new_size] = 0;
                 _size = new_size;
             }
             else if (new_size > _size) {
-                std::memset(_buffer + _size, ch, new_size - _size);
+                kernels::fill(_buffer + _size, ch, new_size - _size);
                 _buffer[new_size] = 0;
                 _size = new_size;
             }
@@ -191,12 +391,17 @@ namespace simple {
         }
         void reserve(size_t new_capacity) {
             if (new_capacity > _capacity) {
-                auto new_buffer = new char[new_capacity + 1];
-                std::memcpy(new_buffer, _buffer, _size);
-                delete[] _buffer;
-                _buffer = new_buffer;
-                _capacity = new_capacity;
+                grow(new_capacity);
             }
         }
     };
-}
\ No newline at end of file
+}
+
+namespace std {
+    template <>
+    struct hash<simple::string> {
+        size_t operator()(const simple::string& str) const noexcept {
+            return str.hash();
+        }
+    };
+}
@@ -1,24 +1,21 @@
 #pragma once
 
+#include <algorithm>
 #include <cstring>
 #include <utility>
+#include <cassert>
+#include <functional>
 
-
-using const_string = std::shared_ptr<const std::string>;
-using mutable_string = std::string;
-
-const_streing make_const(mutable_string&& str){
-    return make_shared(std::move(str));
-}
-
-mutable_string make_mutable(const_string&& str){
-    if (str.unique()){
-        auto str = const_cast<std::string>(*str);
-        return str;
-    }else{
-        return *str;
-    }
-}
+#include "string_algorithms.h"
+#include "string_case.h"
+#include "string_edit_distance.h"
+#include "string_format.h"
+#include "string_hash.h"
+#include "string_kernels.h"
+#include "string_parse.h"
+#include "string_search.h"
+#include "string_split.h"
+#include "string_utf8.h"
 
 namespace sso {
     class string {
@@ -166,19 +163,19 @@ namespace sso {
             if (_capacity < _size + count) {
                 _capacity = calc_capacity(_size + count);
                 auto new_data = new char[_capacity + 1];
-                std::memcpy(new_data, _data, index);
-                std::memset(new_data + index, ch, count);
-                std::memcpy(new_data + _size, _data + index, _size + 1 - index);
+                kernels::copy(new_data, _data, index);
+                kernels::fill(new_data + index, ch, count);
+                kernels::copy(new_data + index + count, _data + index, _size + 1 - index);
                 if (_use_heap) {
-                    delete _data;
+                    delete[] _data;
                 }
                 _use_heap = true;
                 _data = new_data;
                 _size += count;
             }
             else if (count > 0) {
-                std::memmove(_data + index + count, _data + index, _size + 1 - index);
-                std::memset(_data + index, ch, count);
+                kernels::move(_data + index + count, _data + index, _size + 1 - index);
+                kernels::fill(_data + index, ch, count);
                 _size += count;
             }
         }
@@ -187,12 +184,12 @@ namespace sso {
             if (_capacity < _size + count) {
                 _capacity = calc_capacity(_size + count);
                 auto new_data = new char[_capacity + 1];
-                std::memcpy(new_data, _data, index);
-                std::memcpy(new_data + index, str, count);
-                std::memcpy(new_data + index + count, _data + index, _size - index);
+                kernels::copy(new_data, _data, index);
+                kernels::copy(new_data + index, str, count);
+                kernels::copy(new_data + index + count, _data + index, _size - index);
                 new_data[_size + count] = 0;
                 if (_use_heap) {
-                    delete _data;
+                    delete[] _data;
                 }
                 _use_heap = true;
                 _data = new_data;
@@ -202,14 +199,14 @@ namespace sso {
                 // prefix__sufix
                 //    ^^^^^^^
                 // prefi^^^^^^^x__sufix
-                std::memmove(_data + index + count, _data + index, _size + 1 - index);
+                kernels::move(_data + index + count, _data + index, _size + 1 - index);
 
                 if (str + count >= _data + index && str + count <= _data + _size) {
                     // some data pointed by str was moved with memmove
                     if (str < _data + index) {
-                        auto first_part = _data + index - str;
+                        auto first_part = std::min((size_t)(_data + index - str), count);
                         // copy the first part that was not moved
-                        std::memcpy(_data + index, str, first_part);
+                        kernels::copy(_data + index, str, first_part);
                         index += first_part;
                         str += count + first_part;
                         count -= first_part;
@@ -218,11 +215,210 @@ namespace sso {
                         str += count;
                     }
                 }
-                std::memcpy(_data + index, str, count);
+                kernels::copy(_data + index, str, count);
                 _size += count;
             }
         }
 
+        void erase(size_t index, size_t count) {
+            assert(index <= _size);
+            count = std::min(count, _size - index);
+            if (count > 0) {
+                kernels::move(_data + index, _data + index + count, _size + 1 - index - count);
+                _size -= count;
+            }
+        }
+        void replace(size_t index, size_t count, const char* str) {
+            assert(index <= _size);
+            count = std::min(count, _size - index);
+            auto str_size = std::strlen(str);
+            auto new_size = _size - count + str_size;
+            if (_capacity < new_size || algorithms::points_into(str, _data, _size)) {
+                // old buffer is kept until the copy is done, so str may point into it
+                _capacity = calc_capacity(new_size);
+                auto new_data = new char[_capacity + 1];
+                kernels::copy(new_data, _data, index);
+                kernels::copy(new_data + index, str, str_size);
+                kernels::copy(new_data + index + str_size, _data + index + count, _size - index - count);
+                new_data[new_size] = 0;
+                if (_use_heap) {
+                    delete[] _data;
+                }
+                _use_heap = true;
+                _data = new_data;
+                _size = new_size;
+            }
+            else {
+                kernels::move(_data + index + str_size, _data + index + count, _size + 1 - index - count);
+                kernels::copy(_data + index, str, str_size);
+                _size = new_size;
+            }
+        }
+        // counts matches first, so the result is written in one pass with at most one allocation
+        void replace_all(const char* pattern, const char* replacement) {
+            auto pattern_size = std::strlen(pattern);
+            auto replacement_size = std::strlen(replacement);
+            auto count = algorithms::count(_data, _size, pattern, pattern_size);
+            if (count == 0) return;
+            auto new_size = _size - count * pattern_size + count * replacement_size;
+            if (_capacity < new_size
+                || algorithms::points_into(pattern, _data, _size)
+                || algorithms::points_into(replacement, _data, _size)) {
+                _capacity = calc_capacity(new_size);
+                auto new_data = new char[_capacity + 1];
+                algorithms::replace_all(new_data, _data, _size, pattern, pattern_size, replacement, replacement_size);
+                new_data[new_size] = 0;
+                if (_use_heap) {
+                    delete[] _data;
+                }
+                _use_heap = true;
+                _data = new_data;
+                _size = new_size;
+            }
+            else {
+                // growing result is written from the start while the text is read from the end
+                auto src = _data;
+                if (new_size > _size) {
+                    src = _data + _capacity - _size;
+                    kernels::move(src, _data, _size);
+                }
+                algorithms::replace_all(_data, src, _size, pattern, pattern_size, replacement, replacement_size);
+                _data[new_size] = 0;
+                _size = new_size;
+            }
+        }
+
+        // search, returns search::npos if nothing is found
+        size_t find(char ch, size_t pos = 0) const noexcept {
+            return search::find(_data, _size, ch, pos);
+        }
+        size_t find(const char* str, size_t pos = 0) const noexcept {
+            return search::find(_data, _size, str, std::strlen(str), pos);
+        }
+        size_t rfind(char ch, size_t pos = search::npos) const noexcept {
+            return search::rfind(_data, _size, ch, pos);
+        }
+        size_t rfind(const char* str, size_t pos = search::npos) const noexcept {
+            return search::rfind(_data, _size, str, std::strlen(str), pos);
+        }
+        size_t find_first_of(const char* chars, size_t pos = 0) const noexcept {
+            return search::find_first_of(_data, _size, chars, std::strlen(chars), pos);
+        }
+        size_t find_first_not_of(const char* chars, size_t pos = 0) const noexcept {
+            return search::find_first_not_of(_data, _size, chars, std::strlen(chars), pos);
+        }
+
+        // comparison, sizes are checked before any char is read
+        int compare(const string& other) const noexcept {
+            auto size = this->size();
+            auto other_size = other.size();
+            auto res = kernels::compare(_data, other._data, std::min(size, other_size));
+            if (res != 0) return res;
+            return size < other_size ? -1 : size > other_size;
+        }
+        friend bool operator==(const string& lhs, const string& rhs) noexcept {
+            auto size = lhs.size();
+            return size == rhs.size() && kernels::equal(lhs._data, rhs._data, size);
+        }
+        friend bool operator!=(const string& lhs, const string& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+        friend bool operator<(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) < 0;
+        }
+        friend bool operator<=(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) <= 0;
+        }
+        friend bool operator>(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) > 0;
+        }
+        friend bool operator>=(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) >= 0;
+        }
+
+        // ASCII case conversion, other chars are kept
+        void to_lower() noexcept {
+            ascii::to_lower(_data, _size);
+        }
+        void to_upper() noexcept {
+            ascii::to_upper(_data, _size);
+        }
+
+        // ASCII case-insensitive comparison and matching hash
+        bool iequals(const string& other) const noexcept {
+            auto size = this->size();
+            return size == other.size() && ascii::iequal(_data, other._data, size);
+        }
+        int icompare(const string& other) const noexcept {
+            auto size = this->size();
+            auto other_size = other.size();
+            auto res = ascii::icompare(_data, other._data, std::min(size, other_size));
+            if (res != 0) return res;
+            return size < other_size ? -1 : size > other_size;
+        }
+        size_t ihash() const noexcept {
+            return ascii::ihash32(_data, size());
+        }
+
+        // 32-bit hash of the chars
+        size_t hash() const noexcept {
+            return hashing::hash32(_data, _size);
+        }
+
+        // UTF-8 checks
+        bool validate_utf8() const noexcept {
+            return utf8::validate(_data, _size);
+        }
+        size_t count_code_points() const noexcept {
+            return utf8::count_code_points(_data, _size);
+        }
+
+        // Levenshtein distance, the bounded one gives up early
+        // and returns max_distance + 1 for farther strings
+        size_t edit_distance(const string& other) const {
+            return levenshtein::distance(_data, size(), other._data, other.size());
+        }
+        size_t bounded_edit_distance(const string& other, size_t max_distance) const {
+            return levenshtein::distance(_data, size(), other._data, other.size(), max_distance);
+        }
+
+        // zero-copy tokens, valid until the string is modified
+        splitting::range<splitting::char_delimiter> split(char delimiter) const noexcept {
+            return splitting::by_char(_data, _size, delimiter);
+        }
+        splitting::range<splitting::substring_delimiter> split(const char* delimiter) const noexcept {
+            return splitting::by_substring(_data, _size, delimiter);
+        }
+        splitting::range<splitting::any_of_delimiter> split_any_of(const char* delimiters) const noexcept {
+            return splitting::by_any_of(_data, _size, delimiters);
+        }
+
+        // numbers in the shortest form that reads back the same,
+        // no allocations while the result fits the inline buffer
+        template <class Number>
+        static string from_number(Number value) {
+            char buffer[numbers::MAX_CHARS + 1];
+            buffer[numbers::format(buffer, value)] = 0;
+            return string(buffer);
+        }
+        template <class Number>
+        void append_number(Number value) {
+            char buffer[numbers::MAX_CHARS + 1];
+            buffer[numbers::format(buffer, value)] = 0;
+            insert(size(), buffer);
+        }
+
+        // the whole string must be a number, value is kept on errors
+        numbers::parse_error parse_int(int64_t& value) const noexcept {
+            return numbers::parse_int(_data, size(), value);
+        }
+        numbers::parse_error parse_uint(uint64_t& value) const noexcept {
+            return numbers::parse_uint(_data, size(), value);
+        }
+        numbers::parse_error parse_double(double& value) const {
+            return numbers::parse_double(_data, size(), value);
+        }
+
         // for printing
         const char* c_str() const noexcept {
             return _data;
@@ -234,23 +430,20 @@ namespace sso {
         void resize(size_t new_size, char ch = 0) {
             if (_capacity < new_size) {
                 auto new_data = new char[new_size + 1];
-                std::memcpy(new_data, _data, _size);
+                kernels::copy(new_data, _data, _size);
                 if (_use_heap) {
-                    delete _data;
+                    delete[] _data;
                 }
                 _use_heap = true;
                 _data = new_data;
-                std::memset(_data + _size, ch, new_size - _size);
-                _data[new_size] = 0;
-                _size = new_size;
                 _capacity = new_size;
             }
-            else if (new_size < _size) {
+            if (new_size < _size) {
                 _data[new_size] = 0;
                 _size = new_size;
             }
             else if (new_size > _size) {
-                std::memset(_data + _size, ch, new_size - _size);
+                kernels::fill(_data + _size, ch, new_size - _size);
                 _data[new_size] = 0;
                 _size = new_size;
             }
@@ -265,7 +458,7 @@ namespace sso {
                 std::memcpy(new_data, _data, _size);
                 new_data[_size] = 0;
                 if (_use_heap) {
-                    delete _data;
+                    delete[] _data;
                 }
                 _use_heap = true;
                 _data = new_data;
@@ -274,3 +467,12 @@ namespace sso {
         }
     };
 }
+
+namespace std {
+    template <>
+    struct hash<sso::string> {
+        size_t operator()(const sso::string& str) const noexcept {
+            return str.hash();
+        }
+    };
+}
@@ -1,12 +1,41 @@
 #pragma once
 
+#include <algorithm>
 #include <cstring>
 #include <utility>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+
+#include "string_algorithms.h"
+#include "string_case.h"
+#include "string_edit_distance.h"
+#include "string_format.h"
+#include "string_hash.h"
+#include "string_kernels.h"
+#include "string_literal.h"
+#include "string_memory.h"
+#include "string_parse.h"
+#include "string_search.h"
+#include "string_split.h"
+#include "string_utf8.h"
 
 namespace sso3 {
 
     const size_t USE_HEAP_BIT = (size_t)1 << (sizeof(size_t) * 8 - 1);
-    const size_t CAPACITY_MASK = ~USE_HEAP_BIT;
+
+    // 64-bit capacity word keeps facts about the chars between the heap flag and capacity:
+    // [heap flag : 1][hash : 32][valid utf8 : 1][capacity : 30], 0 means the hash is not computed.
+    // 32-bit builds have no spare bits and compute them every time.
+    const bool CACHE_HASH = sizeof(size_t) == 8;
+    const unsigned HASH_SHIFT = 31;
+    const size_t VALID_UTF8_BIT = CACHE_HASH ? (size_t)1 << (HASH_SHIFT - 1) : 0;
+    const size_t CAPACITY_MASK = CACHE_HASH ? VALID_UTF8_BIT - 1 : ~USE_HEAP_BIT;
+    const size_t HASH_MASK = ~USE_HEAP_BIT & ~VALID_UTF8_BIT & ~CAPACITY_MASK;
+    const size_t MAX_CAPACITY = CAPACITY_MASK;
+    // heap buffers are never empty, so the heap flag alone marks static chars
+    const size_t STATIC_CAPACITY = 0;
 
     struct heap_string_data {
         char* _data;
@@ -19,8 +48,34 @@ namespace sso3 {
             return _capacity_and_heap_flag & USE_HEAP_BIT;
         }
         void set_capacity_and_heap_flag(size_t capacity) {
+            assert(capacity <= MAX_CAPACITY);
             _capacity_and_heap_flag = capacity | USE_HEAP_BIT;
         }
+        // any change of chars goes with set_size
+        void set_size(size_t size) {
+            _size = size;
+            reset_cache();
+        }
+        uint32_t cached_hash() const {
+            return (uint32_t)((_capacity_and_heap_flag & HASH_MASK) >> HASH_SHIFT);
+        }
+        void set_cached_hash(uint32_t hash) {
+            _capacity_and_heap_flag = (_capacity_and_heap_flag & ~HASH_MASK) | (((size_t)hash << HASH_SHIFT) & HASH_MASK);
+        }
+        bool cached_valid_utf8() const {
+            return (_capacity_and_heap_flag & VALID_UTF8_BIT) != 0;
+        }
+        void set_cached_valid_utf8() {
+            _capacity_and_heap_flag |= VALID_UTF8_BIT;
+        }
+        void reset_cache() {
+            _capacity_and_heap_flag &= ~(HASH_MASK | VALID_UTF8_BIT);
+        }
+        // facts about equal chars
+        void copy_cache(const heap_string_data& other) {
+            _capacity_and_heap_flag = (_capacity_and_heap_flag & ~(HASH_MASK | VALID_UTF8_BIT))
+                | (other._capacity_and_heap_flag & (HASH_MASK | VALID_UTF8_BIT));
+        }
     };
 
     static_assert(
@@ -60,6 +115,11 @@ namespace sso3 {
             return _small.use_heap();
         }
 
+        // heap data pointing to static chars, the string owns no buffer
+        bool is_static() const {
+            return use_heap() && _heap.capacity() == STATIC_CAPACITY;
+        }
+
         void set_heap_data(const heap_string_data& src) {
             _heap = src;
         }
@@ -80,6 +140,15 @@ namespace sso3 {
             _small.set_size_and_reset_heap_flag(size);
         }
 
+        void set_size(size_t size) {
+            if (use_heap()) {
+                _heap.set_size(size);
+            }
+            else {
+                _small.set_size_and_reset_heap_flag(size);
+            }
+        }
+
         void clear_small_data() {
             _small._buffer[0] = 0;
             _small.set_size_and_reset_heap_flag(0);
@@ -94,6 +163,57 @@ namespace sso3 {
             return res - 1;
         }
 
+        // capacity of a heap buffer for at least required chars
+        static size_t heap_capacity(size_t required) {
+            auto res = memory::round_capacity(required);
+            if (res > MAX_CAPACITY) {
+                throw std::length_error("sso3::string is too long");
+            }
+            return res;
+        }
+
+        void reset_cache() {
+            if (use_heap()) {
+                _heap.reset_cache();
+            }
+        }
+
+        // copies of heap strings take over what other knows about the chars
+        void copy_cache(const string& other) {
+            if (use_heap() && other.use_heap()) {
+                _heap.copy_cache(other._heap);
+            }
+        }
+
+        // keeps the text and terminating zero, large heap buffers are not copied
+        void grow(size_t new_capacity) {
+            new_capacity = heap_capacity(new_capacity);
+            auto size = this->size();
+            char* new_data;
+            if (use_heap() && !is_static()) {
+                new_data = memory::reallocate(_heap._data, size, _heap.capacity(), new_capacity);
+            }
+            else {
+                new_data = memory::allocate(new_capacity);
+                std::memcpy(new_data, data(), size);
+            }
+            new_data[size] = 0;
+            set_heap_data(size, new_capacity, new_data);
+        }
+
+        void free_heap_data() noexcept {
+            if (use_heap() && !is_static()) {
+                memory::deallocate(_heap._data, _heap.capacity());
+            }
+        }
+
+        // static chars are copied to an own buffer before they are changed in place
+        void own_chars() {
+            if (is_static()) {
+                grow(size());
+            }
+        }
+
         char* data() noexcept {
             return use_heap() ? _heap._data : _small._buffer;
         }
@@ -112,9 +232,13 @@ namespace sso3 {
         string(const char* str) {
             auto new_size = std::strlen(str);
             if (new_size > SSO_CAPACITY) {
-                auto new_data = new char[new_size + 1];
+                auto new_capacity = heap_capacity(new_size);
+                auto new_data = memory::allocate(new_capacity);
                 std::memcpy(new_data, str, new_size + 1);
-                set_heap_data(new_size, new_size, new_data);
+                set_heap_data(new_size, new_capacity, new_data);
+                if (CACHE_HASH) {
+                    _heap.set_cached_hash(hashing::hash32(new_data, new_size));
+                }
             }
             else {
                 set_small_data(new_size, str);
@@ -123,16 +247,31 @@ namespace sso3 {
 
         string(const string& other) {
             auto new_size = other.size();
-            if (new_size > SSO_CAPACITY) {
-                auto new_data = new char[new_size + 1];
+            if (other.is_static()) {
+                set_heap_data(other._heap);
+            }
+            else if (new_size > SSO_CAPACITY) {
+                auto new_capacity = heap_capacity(new_size);
+                auto new_data = memory::allocate(new_capacity);
                 std::memcpy(new_data, other.data(), new_size + 1);
-                set_heap_data(new_size, new_size, new_data);
+                set_heap_data(new_size, new_capacity, new_data);
+                _heap.copy_cache(other._heap);
             }
             else {
                 set_small_data(new_size, other.data());
             }
         }
 
+        // static chars are used in place until the first change
+        string(literals::static_chars str) noexcept {
+            if (str.size > SSO_CAPACITY) {
+                set_heap_data(str.size, STATIC_CAPACITY, const_cast<char*>(str.data));
+            }
+            else {
+                set_small_data(str.size, str.data);
+            }
+        }
+
         string(string&& other) noexcept {
             if (other.use_heap()) {
                 set_heap_data(other._heap);
@@ -145,17 +284,23 @@ namespace sso3 {
 
         string& operator=(const string& other) {
             auto new_size = other.size();
-            if (new_size > capacity()) {
-                if (use_heap()) {
-                    delete[] _heap._data;
-                }
-                auto new_data = new char[new_size + 1];
+            if (other.is_static()) {
+                free_heap_data();
+                set_heap_data(other._heap);
+            }
+            else if (is_static() && new_size <= SSO_CAPACITY) {
+                set_small_data(new_size, other.data());
+            }
+            else if (new_size > capacity() || is_static()) {
+                free_heap_data();
+                auto new_capacity = heap_capacity(new_size);
+                auto new_data = memory::allocate(new_capacity);
                 std::memcpy(new_data, other.data(), new_size + 1);
-                set_heap_data(new_size, new_size, new_data);
+                set_heap_data(new_size, new_capacity, new_data);
             }
             else {
                 if (use_heap()) {
-                    _heap._size = new_size;
+                    _heap.set_size(new_size);
                     std::memcpy(_heap._data, other.data(), new_size + 1);
                 }
                 else {
@@ -163,12 +308,11 @@ namespace sso3 {
                     std::memcpy(_small._buffer, other.data(), new_size + 1);
                 }
             }
+            copy_cache(other);
             return *this;
         }
         string& operator=(string&& other) noexcept {
-            if (this->use_heap()) {
-                delete[] _heap._data;
-            }
+            free_heap_data();
 
             if (other.use_heap()) {
                 set_heap_data(other._heap);
@@ -182,9 +326,7 @@ namespace sso3 {
         }
 
         ~string() noexcept {
-            if (use_heap()) {
-                delete[] _heap._data;
-            }
+            free_heap_data();
         }
 
         // useful and interesting
@@ -205,11 +347,15 @@ namespace sso3 {
             }
         }
 
-        // iterators
-        char* begin() noexcept {
+        // iterators, chars may be changed through them
+        char* begin() {
+            own_chars();
+            reset_cache();
             return data();
         }
-        char* end() noexcept {
+        char* end() {
+            own_chars();
+            reset_cache();
             return data() + size();
         }
 
@@ -218,21 +364,14 @@ namespace sso3 {
             auto data = this->data();
             auto size = this->size();
             if (capacity() < size + count) {
-                auto new_capacity = calc_capacity(size + count);
-                auto new_data = new char[new_capacity + 1];
-                std::memcpy(new_data, data, index);
-                std::memset(new_data + index, ch, count);
-                std::memcpy(new_data + size, data + index, size + 1 - index);
-                if (use_heap()) {
-                    delete data;
-                }
-                set_heap_data(size + count, new_capacity, new_data);
+                grow(calc_capacity(size + count));
+                data = this->data();
             }
-            else if (count > 0) {
-                std::memmove(data + index + count, data + index, size + 1 - index);
-                std::memset(data + index, ch, count);
+            if (count > 0) {
+                kernels::move(data + index + count, data + index, size + 1 - index);
+                kernels::fill(data + index, ch, count);
                 if (use_heap()) {
-                    _heap._size = size + count;
+                    _heap.set_size(size + count);
                 }
                 else {
                     _small.set_size_and_reset_heap_flag(size + count);
@@ -244,26 +383,22 @@ namespace sso3 {
             auto data = this->data();
             auto size = this->size();
             if (capacity() < size + count) {
-                auto new_capacity = calc_capacity(size + count);
-                auto new_data = new char[new_capacity + 1];
-                std::memcpy(new_data, data, index);
-                std::memcpy(new_data + index, str, count);
-                std::memcpy(new_data + index + count, data + index, size - index);
-                new_data[size + count] = 0;
-                if (use_heap()) {
-                    delete data;
-                }
-                set_heap_data(size + count, new_capacity, new_data);
+                // str may point into the buffer that is going to be moved
+                auto inside = algorithms::points_into(str, data, size);
+                auto offset = inside ? str - data : 0;
+                grow(calc_capacity(size + count));
+                data = this->data();
+                if (inside) str = data + offset;
             }
-            else {
-                std::memmove(data + index + count, data + index, size + 1 - index);
+            if (count > 0) {
+                kernels::move(data + index + count, data + index, size + 1 - index);
 
                 if (str + count >= data + index && str + count <= data + size) {
                     // some data pointed by str was moved with memmove
                     if (str < data + index) {
-                        auto first_part = data + index - str;
+                        auto first_part = std::min((size_t)(data + index - str), count);
                         // copy the first part that was not moved
-                        std::memcpy(data + index, str, first_part);
+                        kernels::copy(data + index, str, first_part);
                         index += first_part;
                         str += count + first_part;
                         count -= first_part;
@@ -272,9 +407,9 @@ namespace sso3 {
                         str += count;
                     }
                 }
-                std::memcpy(data + index, str, count);
+                kernels::copy(data + index, str, count);
                 if (use_heap()) {
-                    _heap._size = size + count;
+                    _heap.set_size(size + count);
                 }
                 else {
                     _small.set_size_and_reset_heap_flag(size + count);
@@ -282,6 +417,249 @@ namespace sso3 {
             }
         }
 
+        void erase(size_t index, size_t count) {
+            auto size = this->size();
+            assert(index <= size);
+            count = std::min(count, size - index);
+            if (count > 0) {
+                own_chars();
+                auto data = this->data();
+                kernels::move(data + index, data + index + count, size + 1 - index - count);
+                set_size(size - count);
+            }
+        }
+        void replace(size_t index, size_t count, const char* str) {
+            auto data = this->data();
+            auto size = this->size();
+            assert(index <= size);
+            count = std::min(count, size - index);
+            auto str_size = std::strlen(str);
+            auto new_size = size - count + str_size;
+            if (capacity() < new_size || is_static() || algorithms::points_into(str, data, size)) {
+                // old buffer is kept until the copy is done, so str may point into it
+                auto new_capacity = heap_capacity(calc_capacity(new_size));
+                auto new_data = memory::allocate(new_capacity);
+                kernels::copy(new_data, data, index);
+                kernels::copy(new_data + index, str, str_size);
+                kernels::copy(new_data + index + str_size, data + index + count, size - index - count);
+                new_data[new_size] = 0;
+                free_heap_data();
+                set_heap_data(new_size, new_capacity, new_data);
+            }
+            else {
+                kernels::move(data + index + str_size, data + index + count, size + 1 - index - count);
+                kernels::copy(data + index, str, str_size);
+                set_size(new_size);
+            }
+        }
+        // counts matches first, so the result is written in one pass with at most one allocation
+        void replace_all(const char* pattern, const char* replacement) {
+            auto pattern_size = std::strlen(pattern);
+            auto replacement_size = std::strlen(replacement);
+            auto data = this->data();
+            auto size = this->size();
+            auto count = algorithms::count(data, size, pattern, pattern_size);
+            if (count == 0) return;
+            auto new_size = size - count * pattern_size + count * replacement_size;
+            if (capacity() < new_size || is_static()
+                || algorithms::points_into(pattern, data, size)
+                || algorithms::points_into(replacement, data, size)) {
+                auto new_capacity = heap_capacity(calc_capacity(new_size));
+                auto new_data = memory::allocate(new_capacity);
+                algorithms::replace_all(new_data, data, size, pattern, pattern_size, replacement, replacement_size);
+                new_data[new_size] = 0;
+                free_heap_data();
+                set_heap_data(new_size, new_capacity, new_data);
+            }
+            else {
+                // growing result is written from the start while the text is read from the end
+                auto src = data;
+                if (new_size > size) {
+                    src = data + capacity() - size;
+                    kernels::move(src, data, size);
+                }
+                algorithms::replace_all(data, src, size, pattern, pattern_size, replacement, replacement_size);
+                data[new_size] = 0;
+                set_size(new_size);
+            }
+        }
+
+        // search, returns search::npos if nothing is found
+        size_t find(char ch, size_t pos = 0) const noexcept {
+            return search::find(data(), size(), ch, pos);
+        }
+        size_t find(const char* str, size_t pos = 0) const noexcept {
+            return search::find(data(), size(), str, std::strlen(str), pos);
+        }
+        size_t rfind(char ch, size_t pos = search::npos) const noexcept {
+            return search::rfind(data(), size(), ch, pos);
+        }
+        size_t rfind(const char* str, size_t pos = search::npos) const noexcept {
+            return search::rfind(data(), size(), str, std::strlen(str), pos);
+        }
+        size_t find_first_of(const char* chars, size_t pos = 0) const noexcept {
+            return search::find_first_of(data(), size(), chars, std::strlen(chars), pos);
+        }
+        size_t find_first_not_of(const char* chars, size_t pos = 0) const noexcept {
+            return search::find_first_not_of(data(), size(), chars, std::strlen(chars), pos);
+        }
+
+        // comparison, sizes are checked before any char is read
+        int compare(const string& other) const noexcept {
+            auto size = this->size();
+            auto other_size = other.size();
+            auto res = kernels::compare(data(), other.data(), std::min(size, other_size));
+            if (res != 0) return res;
+            return size < other_size ? -1 : size > other_size;
+        }
+        friend bool operator==(const string& lhs, const string& rhs) noexcept {
+            if (((lhs._small._size_and_heap_flag | rhs._small._size_and_heap_flag) & 128) == 0) {
+                // both are small, equal sizes have equal size bytes
+                return lhs._small._size_and_heap_flag == rhs._small._size_and_heap_flag
+                    && kernels::equal(lhs._small._buffer, rhs._small._buffer, lhs._small.size());
+            }
+            auto size = lhs.size();
+            return size == rhs.size() && kernels::equal(lhs.data(), rhs.data(), size);
+        }
+        friend bool operator!=(const string& lhs, const string& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+        friend bool operator<(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) < 0;
+        }
+        friend bool operator<=(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) <= 0;
+        }
+        friend bool operator>(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) > 0;
+        }
+        friend bool operator>=(const string& lhs, const string& rhs) noexcept {
+            return lhs.compare(rhs) >= 0;
+        }
+
+        // ASCII case conversion, other chars are kept
+        void to_lower() {
+            if (use_heap()) {
+                own_chars();
+                _heap.reset_cache();
+                ascii::to_lower(_heap._data, _heap._size);
+            }
+            else {
+                // the whole inline buffer, chars after the end do not matter
+                ascii::to_lower(_small._buffer, SSO_BUFFER_SIZE);
+            }
+        }
+        void to_upper() {
+            if (use_heap()) {
+                own_chars();
+                _heap.reset_cache();
+                ascii::to_upper(_heap._data, _heap._size);
+            }
+            else {
+                // the whole inline buffer, chars after the end do not matter
+                ascii::to_upper(_small._buffer, SSO_BUFFER_SIZE);
+            }
+        }
+
+        // ASCII case-insensitive comparison and matching hash
+        bool iequals(const string& other) const noexcept {
+            auto size = this->size();
+            return size == other.size() && ascii::iequal(data(), other.data(), size);
+        }
+        int icompare(const string& other) const noexcept {
+            auto size = this->size();
+            auto other_size = other.size();
+            auto res = ascii::icompare(data(), other.data(), std::min(size, other_size));
+            if (res != 0) return res;
+            return size < other_size ? -1 : size > other_size;
+        }
+        size_t ihash() const noexcept {
+            return ascii::ihash32(data(), size());
+        }
+
+        // 32-bit hash of the chars. Heap strings made from chars cache it until the next
+        // modification, copies take the cached value over and the non-const hash() caches
+        // it again. The const one never writes, so many threads may call it on one string.
+        size_t hash() const noexcept {
+            if (!use_heap()) {
+                return hashing::hash32(_small._buffer, _small.size());
+            }
+            auto res = _heap.cached_hash();
+            return res != 0 ? res : hashing::hash32(_heap._data, _heap._size);
+        }
+        size_t hash() noexcept {
+            auto res = static_cast<const string&>(*this).hash();
+            if (use_heap()) {
+                _heap.set_cached_hash((uint32_t)res);
+            }
+            return res;
+        }
+
+        // UTF-8 checks, the non-const validate_utf8() caches a success of heap strings
+        // until the next modification, the const one only reads it like hash()
+        bool validate_utf8() const noexcept {
+            if (!use_heap()) {
+                return utf8::validate(_small._buffer, _small.size());
+            }
+            return _heap.cached_valid_utf8() || utf8::validate(_heap._data, _heap._size);
+        }
+        bool validate_utf8() noexcept {
+            auto res = static_cast<const string&>(*this).validate_utf8();
+            if (res && use_heap()) {
+                _heap.set_cached_valid_utf8();
+            }
+            return res;
+        }
+        size_t count_code_points() const noexcept {
+            return utf8::count_code_points(data(), size());
+        }
+
+        // Levenshtein distance, the bounded one gives up early
+        // and returns max_distance + 1 for farther strings
+        size_t edit_distance(const string& other) const {
+            return levenshtein::distance(data(), size(), other.data(), other.size());
+        }
+        size_t bounded_edit_distance(const string& other, size_t max_distance) const {
+            return levenshtein::distance(data(), size(), other.data(), other.size(), max_distance);
+        }
+
+        // zero-copy tokens, valid until the string is modified
+        splitting::range<splitting::char_delimiter> split(char delimiter) const noexcept {
+            return splitting::by_char(data(), size(), delimiter);
+        }
+        splitting::range<splitting::substring_delimiter> split(const char* delimiter) const noexcept {
+            return splitting::by_substring(data(), size(), delimiter);
+        }
+        splitting::range<splitting::any_of_delimiter> split_any_of(const char* delimiters) const noexcept {
+            return splitting::by_any_of(data(), size(), delimiters);
+        }
+
+        // numbers in the shortest form that reads back the same,
+        // no allocations while the result fits the inline buffer
+        template <class Number>
+        static string from_number(Number value) {
+            char buffer[numbers::MAX_CHARS + 1];
+            buffer[numbers::format(buffer, value)] = 0;
+            return string(buffer);
+        }
+        template <class Number>
+        void append_number(Number value) {
+            char buffer[numbers::MAX_CHARS + 1];
+            buffer[numbers::format(buffer, value)] = 0;
+            insert(size(), buffer);
+        }
+
+        // the whole string must be a number, value is kept on errors
+        numbers::parse_error parse_int(int64_t& value) const noexcept {
+            return numbers::parse_int(data(), size(), value);
+        }
+        numbers::parse_error parse_uint(uint64_t& value) const noexcept {
+            return numbers::parse_uint(data(), size(), value);
+        }
+        numbers::parse_error parse_double(double& value) const {
+            return numbers::parse_double(data(), size(), value);
+        }
+
         // for printing
         const char* c_str() const noexcept {
             return data();
@@ -294,19 +672,15 @@ namespace sso3 {
         void resize(size_t new_size, char ch = 0) {
             auto old_size = size();
             if (capacity() < new_size) {
-                auto new_data = new char[new_size + 1];
-                std::memcpy(new_data, data(), old_size);
-                if (use_heap()) {
-                    delete _heap._data;
-                }
-                std::memset(new_data + old_size, ch, new_size - old_size);
-                new_data[new_size] = 0;
-                set_heap_data(new_size, new_size, new_data);
+                grow(new_size);
             }
             else if (new_size < old_size) {
+                own_chars();
+            }
+            if (new_size < old_size) {
                 if (use_heap()) {
                     _heap._data[new_size] = 0;
-                    _heap._size = new_size;
+                    _heap.set_size(new_size);
                 }
                 else {
                     _small._buffer[new_size] = 0;
@@ -315,32 +689,26 @@ namespace sso3 {
             }
             else if (new_size > old_size) {
                 if (use_heap()) {
-                    std::memset(_heap._data + old_size, ch, new_size - old_size);
+                    kernels::fill(_heap._data + old_size, ch, new_size - old_size);
                     _heap._data[new_size] = 0;
-                    _heap._size = new_size;
+                    _heap.set_size(new_size);
                 }
                 else {
-                    std::memset(_small._buffer + old_size, ch, new_size - old_size);
+                    kernels::fill_inline(_small._buffer + old_size, ch, new_size - old_size);
                     _small._buffer[new_size] = 0;
                     _small.set_size_and_reset_heap_flag(new_size);
                 }
             }
         }
 
+        // static chars can't take more chars than they have
         size_t capacity() const noexcept {
-            return use_heap() ? _heap.capacity() : SSO_CAPACITY;
+            return !use_heap() ? (size_t)SSO_CAPACITY : is_static() ? _heap._size : _heap.capacity();
         }
 
         void reserve(size_t new_capacity) {
-            auto size = this->size();
-            if (new_capacity >= capacity()) {
-                auto new_data = new char[new_capacity + 1];
-                std::memcpy(new_data, data(), size);
-                new_data[size] = 0;
-                if (use_heap()) {
-                    delete _heap._data;
-                }
-                set_heap_data(size, new_capacity, new_data);
+            if (new_capacity > capacity()) {
+                grow(new_capacity);
             }
         }
     };
@@ -349,3 +717,12 @@ namespace sso3 {
         sizeof(string) == sizeof(small_string_data),
         "sizeof(string) != sizeof(small_string_data)");
 }
+
+namespace std {
+    template <>
+    struct hash<sso3::string> {
+        size_t operator()(const sso3::string& str) const noexcept {
+            return str.hash();
+        }
+    };
+}
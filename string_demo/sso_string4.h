@@ -0,0 +1,841 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <utility>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <stdexcept>
+
+#include "string_algorithms.h"
+#include "string_case.h"
+#include "string_edit_distance.h"
+#include "string_format.h"
+#include "string_hash.h"
+#include "string_kernels.h"
+#include "string_literal.h"
+#include "string_memory.h"
+#include "string_parse.h"
+#include "string_search.h"
+#include "string_split.h"
+#include "string_utf8.h"
+
+namespace sso4 {
+
+    // 64-bit capacity word keeps facts about the chars in the high bits:
+    // [hash : 32][valid utf8 : 1][capacity : 31], heap flag is the lowest bit of the odd capacity,
+    // 0 means the hash is not computed. 32-bit builds have no spare bits and compute them every time.
+    const bool CACHE_HASH = sizeof(size_t) == 8;
+    const unsigned HASH_SHIFT = 32;
+    const size_t VALID_UTF8_BIT = (size_t)(CACHE_HASH ? 0x80000000ull : 0);
+    const size_t CAPACITY_MASK = (size_t)(CACHE_HASH ? 0x7FFFFFFFull : ~0ull);
+    const size_t HASH_MASK = ~(VALID_UTF8_BIT | CAPACITY_MASK);
+    const size_t MAX_CAPACITY = CAPACITY_MASK;
+    // heap buffers are never that small, so the heap flag alone marks static chars
+    const size_t STATIC_CAPACITY = 1;
+
+    struct heap_string_data {
+        size_t _capacity_and_heap_flag;
+        char* _data;
+        size_t _size;
+        size_t capacity() const {
+            return _capacity_and_heap_flag & CAPACITY_MASK;
+        }
+        bool use_heap() const {
+            return _capacity_and_heap_flag & 1;
+        }
+        void set_capacity_and_heap_flag(size_t capacity) {
+            assert(capacity & 1);
+            assert(capacity <= MAX_CAPACITY);
+            _capacity_and_heap_flag = capacity;
+        }
+        // any change of chars goes with set_size
+        void set_size(size_t size) {
+            _size = size;
+            reset_cache();
+        }
+        uint32_t cached_hash() const {
+            return (uint32_t)((uint64_t)(_capacity_and_heap_flag & HASH_MASK) >> HASH_SHIFT);
+        }
+        void set_cached_hash(uint32_t hash) {
+            _capacity_and_heap_flag = (_capacity_and_heap_flag & ~HASH_MASK) | ((size_t)((uint64_t)hash << HASH_SHIFT) & HASH_MASK);
+        }
+        bool cached_valid_utf8() const {
+            return (_capacity_and_heap_flag & VALID_UTF8_BIT) != 0;
+        }
+        void set_cached_valid_utf8() {
+            _capacity_and_heap_flag |= VALID_UTF8_BIT;
+        }
+        void reset_cache() {
+            _capacity_and_heap_flag &= ~(HASH_MASK | VALID_UTF8_BIT);
+        }
+        // facts about equal chars
+        void copy_cache(const heap_string_data& other) {
+            _capacity_and_heap_flag = (_capacity_and_heap_flag & ~(HASH_MASK | VALID_UTF8_BIT))
+                | (other._capacity_and_heap_flag & (HASH_MASK | VALID_UTF8_BIT));
+        }
+    };
+
+    static_assert(
+        sizeof(heap_string_data) == 3 * sizeof(void*),
+        "sizeof(heap_string_data) != 3*sizeof(void*)");
+
+    enum {
+        SSO_BUFFER_SIZE = sizeof(heap_string_data) - 1,
+        SSO_CAPACITY = SSO_BUFFER_SIZE - 1
+    };
+
+    static_assert(SSO_CAPACITY == 22, "SSO_CAPACITY != 22");
+
+    struct small_string_data {
+        char _size_and_heap_flag;
+        char _buffer[SSO_BUFFER_SIZE];
+        size_t size() const {
+            return SSO_CAPACITY - _size_and_heap_flag / 2;
+        }
+        bool use_heap() const {
+            return _size_and_heap_flag & 1;
+        }
+        void set_size_and_reset_heap_flag(size_t size) {
+            assert(size <= SSO_CAPACITY);
+            _size_and_heap_flag = (char)((SSO_CAPACITY - size) * 2);
+        }
+    };
+
+    // Who owns a heap buffer. unique_buffers belong to one string, copies copy the chars.
+    // shared_buffers start with a reference count, copies of a heap string share the buffer
+    // and the first change through any of them copies it (copy on write).
+    // Static chars are shared by copies in both.
+    struct unique_buffers {
+        static const bool SHARED = false;
+    };
+
+    struct shared_buffers {
+        static const bool SHARED = true;
+    };
+
+    template <class Buffers>
+    class basic_string {
+
+        union
+        {
+            small_string_data _small;
+            heap_string_data _heap;
+        };
+        
+        bool use_heap() const {
+            return _small.use_heap();
+        }
+
+        // heap data pointing to static chars, the string owns no buffer
+        bool is_static() const {
+            return use_heap() && _heap.capacity() == STATIC_CAPACITY;
+        }
+
+        using refcount = std::atomic<size_t>;
+
+        enum : size_t {
+            HEADER_SIZE = Buffers::SHARED ? sizeof(refcount) : 0
+        };
+
+        // reference count of a shared heap buffer
+        refcount& refs() const noexcept {
+            return *reinterpret_cast<refcount*>(_heap._data - HEADER_SIZE);
+        }
+
+        // chars may be changed in place, nobody else sees them
+        bool writable() const noexcept {
+            if (!use_heap()) return true;
+            if (is_static()) return false;
+            return !Buffers::SHARED || refs().load(std::memory_order_acquire) == 1;
+        }
+
+        // copies take the heap data as it is
+        bool shared_by_copies() const noexcept {
+            return is_static() || (Buffers::SHARED && use_heap());
+        }
+
+        void retain_chars() const noexcept {
+            if (!is_static()) {
+                refs().fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // buffer for capacity chars with one reference
+        static char* allocate_buffer(size_t capacity) {
+            auto res = memory::allocate(capacity + HEADER_SIZE);
+            if (Buffers::SHARED) {
+                new (res) refcount(1);
+            }
+            return res + HEADER_SIZE;
+        }
+
+        static void deallocate_buffer(char* data, size_t capacity) noexcept {
+            memory::deallocate(data - HEADER_SIZE, capacity + HEADER_SIZE);
+        }
+
+        static char* reallocate_buffer(char* data, size_t size, size_t capacity, size_t new_capacity) {
+            return memory::reallocate(data - HEADER_SIZE, size + HEADER_SIZE,
+                capacity + HEADER_SIZE, new_capacity + HEADER_SIZE) + HEADER_SIZE;
+        }
+
+        void set_heap_data(const heap_string_data& src) {
+            _heap = src;
+        }
+
+        void set_heap_data(size_t size, size_t capacity, char* data) {
+            _heap._size = size;
+            _heap._data = data;
+            _heap.set_capacity_and_heap_flag(capacity);
+        }
+
+        void set_small_data(const small_string_data& src) {
+            _small = src;
+        }
+
+        void set_small_data(size_t size, const char* src) {
+            std::memcpy(_small._buffer, src, size + 1);
+            assert(size <= SSO_CAPACITY);
+            _small.set_size_and_reset_heap_flag(size);
+        }
+
+        void set_size(size_t size) {
+            if (use_heap()) {
+                _heap.set_size(size);
+            }
+            else {
+                _small.set_size_and_reset_heap_flag(size);
+            }
+        }
+
+        void clear_small_data() {
+            _small._buffer[0] = 0;
+            _small.set_size_and_reset_heap_flag(0);
+        }
+
+        size_t calc_capacity(size_t required_size) const {
+            if (required_size <= capacity()) return capacity();
+            size_t res = 16u;
+            while (res < required_size + 1) {
+                res *= 2; // run over powers of two
+            }
+            return res - 1;
+        }
+
+        size_t estimate_capacity(size_t required_size) const {
+            return required_size | 1;
+        }
+
+        // capacity of a heap buffer for at least required chars, the header included
+        static size_t heap_capacity(size_t required) {
+            auto res = memory::round_capacity(required + HEADER_SIZE) - HEADER_SIZE;
+            if (res > MAX_CAPACITY) {
+                throw std::length_error("sso4::string is too long");
+            }
+            return res;
+        }
+
+        void reset_cache() {
+            if (use_heap()) {
+                _heap.reset_cache();
+            }
+        }
+
+        // copies of heap strings take over what other knows about the chars
+        void copy_cache(const basic_string& other) {
+            if (use_heap() && other.use_heap()) {
+                _heap.copy_cache(other._heap);
+            }
+        }
+
+        // keeps the text and terminating zero, large heap buffers are not copied
+        void grow(size_t new_capacity) {
+            new_capacity = heap_capacity(new_capacity);
+            auto size = this->size();
+            char* new_data;
+            if (use_heap() && writable()) {
+                new_data = reallocate_buffer(_heap._data, size, _heap.capacity(), new_capacity);
+            }
+            else {
+                new_data = allocate_buffer(new_capacity);
+                std::memcpy(new_data, data(), size);
+                free_heap_data();
+            }
+            new_data[size] = 0;
+            set_heap_data(size, new_capacity, new_data);
+        }
+
+        // the last string using a shared buffer frees it
+        void free_heap_data() noexcept {
+            if (use_heap() && !is_static()
+                && (!Buffers::SHARED || refs().fetch_sub(1, std::memory_order_acq_rel) == 1)) {
+                deallocate_buffer(_heap._data, _heap.capacity());
+            }
+        }
+
+        // static chars and shared buffers are copied to an own buffer before they are changed in place
+        void own_chars() {
+            if (!writable()) {
+                grow(is_static() ? estimate_capacity(size()) : _heap.capacity());
+            }
+        }
+
+        char* data() noexcept {
+            return use_heap() ? _heap._data : _small._buffer;
+        }
+
+        const char* data() const noexcept {
+            return use_heap() ? _heap._data : _small._buffer;
+        }
+
+    public:
+        // default constructed
+        basic_string() noexcept {
+            clear_small_data();
+        }
+
+        // construct from c-string
+        basic_string(const char* str) {
+            auto new_size = std::strlen(str);
+            if (new_size > SSO_CAPACITY) {
+                auto new_capacity = heap_capacity(estimate_capacity(new_size));
+                auto new_data = allocate_buffer(new_capacity);
+                std::memcpy(new_data, str, new_size + 1);
+                set_heap_data(new_size, new_capacity, new_data);
+                if (CACHE_HASH) {
+                    _heap.set_cached_hash(hashing::hash32(new_data, new_size));
+                }
+            }
+            else {
+                set_small_data(new_size, str);
+            }
+        }
+
+        basic_string(const basic_string& other) {
+            auto new_size = other.size();
+            if (other.shared_by_copies()) {
+                other.retain_chars();
+                set_heap_data(other._heap);
+            }
+            else if (new_size > SSO_CAPACITY) {
+                auto new_capacity = heap_capacity(estimate_capacity(new_size));
+                auto new_data = allocate_buffer(new_capacity);
+                std::memcpy(new_data, other.data(), new_size + 1);
+                set_heap_data(new_size, new_capacity, new_data);
+                _heap.copy_cache(other._heap);
+            }
+            else {
+                set_small_data(new_size, other.data());
+            }
+        }
+
+        // static chars are used in place until the first change
+        basic_string(literals::static_chars str) noexcept {
+            if (str.size > SSO_CAPACITY) {
+                set_heap_data(str.size, STATIC_CAPACITY, const_cast<char*>(str.data));
+            }
+            else {
+                set_small_data(str.size, str.data);
+            }
+        }
+
+        basic_string(basic_string&& other) noexcept {
+            if (other.use_heap()) {
+                set_heap_data(other._heap);
+                other.clear_small_data();
+            }
+            else {
+                set_small_data(other._small);
+            }
+        }
+
+        basic_string& operator=(const basic_string& other) {
+            auto new_size = other.size();
+            if (other.shared_by_copies()) {
+                // retained first, other may be this string
+                other.retain_chars();
+                free_heap_data();
+                set_heap_data(other._heap);
+            }
+            else if (!writable() && new_size <= SSO_CAPACITY) {
+                free_heap_data();
+                set_small_data(new_size, other.data());
+            }
+            else if (new_size > capacity() || !writable()) {
+                auto new_capacity = heap_capacity(estimate_capacity(new_size));
+                auto new_data = allocate_buffer(new_capacity);
+                std::memcpy(new_data, other.data(), new_size + 1);
+                free_heap_data();
+                set_heap_data(new_size, new_capacity, new_data);
+            }
+            else {
+                if (use_heap()) {
+                    _heap.set_size(new_size);
+                    std::memcpy(_heap._data, other.data(), new_size + 1);
+                }
+                else {
+                    _small.set_size_and_reset_heap_flag(new_size);
+                    std::memcpy(_small._buffer, other.data(), new_size + 1);
+                }
+            }
+            copy_cache(other);
+            return *this;
+        }
+        basic_string& operator=(basic_string&& other) noexcept {
+            free_heap_data();
+
+            if (other.use_heap()) {
+                set_heap_data(other._heap);
+                other.clear_small_data();
+            }
+            else {
+                set_small_data(other._small);
+            }
+
+            return *this;
+        }
+
+        ~basic_string() noexcept {
+            free_heap_data();
+        }
+
+        // useful and interesting
+        void swap(basic_string& other) noexcept {
+            if (this->use_heap() && other.use_heap()) {
+                std::swap(this->_heap, other._heap);
+            }
+            else if (!this->use_heap() && !other.use_heap()) {
+                std::swap(this->_small, other._small);
+            }
+            else if (this->use_heap() && !other.use_heap()) {
+                auto tmp_heap = this->_heap;
+                set_small_data(other._small);
+                other.set_heap_data(tmp_heap);
+            }
+            else if (!this->use_heap() && other.use_heap()) {
+                other.swap(*this);
+            }
+        }
+
+        // heap buffer handed to another owner (shared::const_string) and back,
+        // data is null for small strings, static chars and shared buffers, releasing leaves the string empty
+        struct heap_buffer {
+            char* data;
+            size_t size;
+            size_t capacity;
+        };
+        heap_buffer release_heap_buffer() noexcept {
+            if (!use_heap() || is_static() || Buffers::SHARED) return heap_buffer{ nullptr, size(), 0 };
+            heap_buffer res{ _heap._data, _heap._size, _heap.capacity() };
+            clear_small_data();
+            return res;
+        }
+        // buffer from memory::allocate with odd capacity, chars and terminating zero
+        static bool can_adopt(size_t capacity) noexcept {
+            return !Buffers::SHARED && (capacity & 1) && capacity != STATIC_CAPACITY && capacity <= MAX_CAPACITY;
+        }
+        static basic_string adopt_heap_buffer(heap_buffer buffer) noexcept {
+            static_assert(!Buffers::SHARED, "shared buffers start with a reference count");
+            assert(can_adopt(buffer.capacity) && buffer.size <= buffer.capacity);
+            basic_string res;
+            res.set_heap_data(buffer.size, buffer.capacity, buffer.data);
+            return res;
+        }
+
+        // iterators, chars may be changed through them
+        char* begin() {
+            own_chars();
+            reset_cache();
+            return data();
+        }
+        char* end() {
+            own_chars();
+            reset_cache();
+            return data() + size();
+        }
+
+        // some modifications to have fun
+        void insert(size_t index, size_t count, char ch) {
+            auto data = this->data();
+            auto size = this->size();
+            if (capacity() < size + count) {
+                grow(calc_capacity(size + count));
+                data = this->data();
+            }
+            else if (count > 0 && !writable()) {
+                own_chars();
+                data = this->data();
+            }
+            if (count > 0) {
+                kernels::move(data + index + count, data + index, size + 1 - index);
+                kernels::fill(data + index, ch, count);
+                if (use_heap()) {
+                    _heap.set_size(size + count);
+                }
+                else {
+                    _small.set_size_and_reset_heap_flag(size + count);
+                }
+            }
+        }
+        void insert(size_t index, const char* str) {
+            auto count = std::strlen(str);
+            auto data = this->data();
+            auto size = this->size();
+            if (capacity() < size + count || (count > 0 && !writable())) {
+                // str may point into the buffer that is going to be moved
+                auto inside = algorithms::points_into(str, data, size);
+                auto offset = inside ? str - data : 0;
+                if (capacity() < size + count) {
+                    grow(calc_capacity(size + count));
+                }
+                else {
+                    own_chars();
+                }
+                data = this->data();
+                if (inside) str = data + offset;
+            }
+            if (count > 0) {
+                kernels::move(data + index + count, data + index, size + 1 - index);
+
+                if (str + count >= data + index && str + count <= data + size) {
+                    // some data pointed by str was moved with memmove
+                    if (str < data + index) {
+                        auto first_part = std::min((size_t)(data + index - str), count);
+                        // copy the first part that was not moved
+                        kernels::copy(data + index, str, first_part);
+                        index += first_part;
+                        str += count + first_part;
+                        count -= first_part;
+                    }
+                    else {
+                        str += count;
+                    }
+                }
+                kernels::copy(data + index, str, count);
+                if (use_heap()) {
+                    _heap.set_size(size + count);
+                }
+                else {
+                    _small.set_size_and_reset_heap_flag(size + count);
+                }
+            }
+        }
+
+        void erase(size_t index, size_t count) {
+            auto size = this->size();
+            assert(index <= size);
+            count = std::min(count, size - index);
+            if (count > 0) {
+                own_chars();
+                auto data = this->data();
+                kernels::move(data + index, data + index + count, size + 1 - index - count);
+                set_size(size - count);
+            }
+        }
+        void replace(size_t index, size_t count, const char* str) {
+            auto data = this->data();
+            auto size = this->size();
+            assert(index <= size);
+            count = std::min(count, size - index);
+            auto str_size = std::strlen(str);
+            auto new_size = size - count + str_size;
+            if (capacity() < new_size || !writable() || algorithms::points_into(str, data, size)) {
+                // old buffer is kept until the copy is done, so str may point into it
+                auto new_capacity = heap_capacity(calc_capacity(new_size));
+                auto new_data = allocate_buffer(new_capacity);
+                kernels::copy(new_data, data, index);
+                kernels::copy(new_data + index, str, str_size);
+                kernels::copy(new_data + index + str_size, data + index + count, size - index - count);
+                new_data[new_size] = 0;
+                free_heap_data();
+                set_heap_data(new_size, new_capacity, new_data);
+            }
+            else {
+                kernels::move(data + index + str_size, data + index + count, size + 1 - index - count);
+                kernels::copy(data + index, str, str_size);
+                set_size(new_size);
+            }
+        }
+        // counts matches first, so the result is written in one pass with at most one allocation
+        void replace_all(const char* pattern, const char* replacement) {
+            auto pattern_size = std::strlen(pattern);
+            auto replacement_size = std::strlen(replacement);
+            auto data = this->data();
+            auto size = this->size();
+            auto count = algorithms::count(data, size, pattern, pattern_size);
+            if (count == 0) return;
+            auto new_size = size - count * pattern_size + count * replacement_size;
+            if (capacity() < new_size || !writable()
+                || algorithms::points_into(pattern, data, size)
+                || algorithms::points_into(replacement, data, size)) {
+                auto new_capacity = heap_capacity(calc_capacity(new_size));
+                auto new_data = allocate_buffer(new_capacity);
+                algorithms::replace_all(new_data, data, size, pattern, pattern_size, replacement, replacement_size);
+                new_data[new_size] = 0;
+                free_heap_data();
+                set_heap_data(new_size, new_capacity, new_data);
+            }
+            else {
+                // growing result is written from the start while the text is read from the end
+                auto src = data;
+                if (new_size > size) {
+                    src = data + capacity() - size;
+                    kernels::move(src, data, size);
+                }
+                algorithms::replace_all(data, src, size, pattern, pattern_size, replacement, replacement_size);
+                data[new_size] = 0;
+                set_size(new_size);
+            }
+        }
+
+        // search, returns search::npos if nothing is found
+        size_t find(char ch, size_t pos = 0) const noexcept {
+            return search::find(data(), size(), ch, pos);
+        }
+        size_t find(const char* str, size_t pos = 0) const noexcept {
+            return search::find(data(), size(), str, std::strlen(str), pos);
+        }
+        size_t rfind(char ch, size_t pos = search::npos) const noexcept {
+            return search::rfind(data(), size(), ch, pos);
+        }
+        size_t rfind(const char* str, size_t pos = search::npos) const noexcept {
+            return search::rfind(data(), size(), str, std::strlen(str), pos);
+        }
+        size_t find_first_of(const char* chars, size_t pos = 0) const noexcept {
+            return search::find_first_of(data(), size(), chars, std::strlen(chars), pos);
+        }
+        size_t find_first_not_of(const char* chars, size_t pos = 0) const noexcept {
+            return search::find_first_not_of(data(), size(), chars, std::strlen(chars), pos);
+        }
+
+        // comparison, sizes are checked before any char is read
+        int compare(const basic_string& other) const noexcept {
+            auto size = this->size();
+            auto other_size = other.size();
+            auto res = kernels::compare(data(), other.data(), std::min(size, other_size));
+            if (res != 0) return res;
+            return size < other_size ? -1 : size > other_size;
+        }
+        friend bool operator==(const basic_string& lhs, const basic_string& rhs) noexcept {
+            if (((lhs._small._size_and_heap_flag | rhs._small._size_and_heap_flag) & 1) == 0) {
+                // both are small, equal sizes have equal size bytes
+                return lhs._small._size_and_heap_flag == rhs._small._size_and_heap_flag
+                    && kernels::equal(lhs._small._buffer, rhs._small._buffer, lhs._small.size());
+            }
+            auto size = lhs.size();
+            return size == rhs.size() && kernels::equal(lhs.data(), rhs.data(), size);
+        }
+        friend bool operator!=(const basic_string& lhs, const basic_string& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+        friend bool operator<(const basic_string& lhs, const basic_string& rhs) noexcept {
+            return lhs.compare(rhs) < 0;
+        }
+        friend bool operator<=(const basic_string& lhs, const basic_string& rhs) noexcept {
+            return lhs.compare(rhs) <= 0;
+        }
+        friend bool operator>(const basic_string& lhs, const basic_string& rhs) noexcept {
+            return lhs.compare(rhs) > 0;
+        }
+        friend bool operator>=(const basic_string& lhs, const basic_string& rhs) noexcept {
+            return lhs.compare(rhs) >= 0;
+        }
+
+        // ASCII case conversion, other chars are kept
+        void to_lower() {
+            if (use_heap()) {
+                own_chars();
+                _heap.reset_cache();
+                ascii::to_lower(_heap._data, _heap._size);
+            }
+            else {
+                // the whole inline buffer, chars after the end do not matter
+                ascii::to_lower(_small._buffer, SSO_BUFFER_SIZE);
+            }
+        }
+        void to_upper() {
+            if (use_heap()) {
+                own_chars();
+                _heap.reset_cache();
+                ascii::to_upper(_heap._data, _heap._size);
+            }
+            else {
+                // the whole inline buffer, chars after the end do not matter
+                ascii::to_upper(_small._buffer, SSO_BUFFER_SIZE);
+            }
+        }
+
+        // ASCII case-insensitive comparison and matching hash
+        bool iequals(const basic_string& other) const noexcept {
+            auto size = this->size();
+            return size == other.size() && ascii::iequal(data(), other.data(), size);
+        }
+        int icompare(const basic_string& other) const noexcept {
+            auto size = this->size();
+            auto other_size = other.size();
+            auto res = ascii::icompare(data(), other.data(), std::min(size, other_size));
+            if (res != 0) return res;
+            return size < other_size ? -1 : size > other_size;
+        }
+        size_t ihash() const noexcept {
+            return ascii::ihash32(data(), size());
+        }
+
+        // 32-bit hash of the chars. Heap strings made from chars cache it until the next
+        // modification, copies take the cached value over and the non-const hash() caches
+        // it again. The const one never writes, so many threads may call it on one string.
+        size_t hash() const noexcept {
+            if (!use_heap()) {
+                return hashing::hash32(_small._buffer, _small.size());
+            }
+            auto res = _heap.cached_hash();
+            return res != 0 ? res : hashing::hash32(_heap._data, _heap._size);
+        }
+        size_t hash() noexcept {
+            auto res = static_cast<const basic_string&>(*this).hash();
+            if (use_heap()) {
+                _heap.set_cached_hash((uint32_t)res);
+            }
+            return res;
+        }
+
+        // UTF-8 checks, the non-const validate_utf8() caches a success of heap strings
+        // until the next modification, the const one only reads it like hash()
+        bool validate_utf8() const noexcept {
+            if (!use_heap()) {
+                return utf8::validate(_small._buffer, _small.size());
+            }
+            return _heap.cached_valid_utf8() || utf8::validate(_heap._data, _heap._size);
+        }
+        bool validate_utf8() noexcept {
+            auto res = static_cast<const basic_string&>(*this).validate_utf8();
+            if (res && use_heap()) {
+                _heap.set_cached_valid_utf8();
+            }
+            return res;
+        }
+        size_t count_code_points() const noexcept {
+            return utf8::count_code_points(data(), size());
+        }
+
+        // Levenshtein distance, the bounded one gives up early
+        // and returns max_distance + 1 for farther strings
+        size_t edit_distance(const basic_string& other) const {
+            return levenshtein::distance(data(), size(), other.data(), other.size());
+        }
+        size_t bounded_edit_distance(const basic_string& other, size_t max_distance) const {
+            return levenshtein::distance(data(), size(), other.data(), other.size(), max_distance);
+        }
+
+        // zero-copy tokens, valid until the string is modified
+        splitting::range<splitting::char_delimiter> split(char delimiter) const noexcept {
+            return splitting::by_char(data(), size(), delimiter);
+        }
+        splitting::range<splitting::substring_delimiter> split(const char* delimiter) const noexcept {
+            return splitting::by_substring(data(), size(), delimiter);
+        }
+        splitting::range<splitting::any_of_delimiter> split_any_of(const char* delimiters) const noexcept {
+            return splitting::by_any_of(data(), size(), delimiters);
+        }
+
+        // numbers in the shortest form that reads back the same,
+        // no allocations while the result fits the inline buffer
+        template <class Number>
+        static basic_string from_number(Number value) {
+            char buffer[numbers::MAX_CHARS + 1];
+            buffer[numbers::format(buffer, value)] = 0;
+            return basic_string(buffer);
+        }
+        template <class Number>
+        void append_number(Number value) {
+            char buffer[numbers::MAX_CHARS + 1];
+            buffer[numbers::format(buffer, value)] = 0;
+            insert(size(), buffer);
+        }
+
+        // the whole string must be a number, value is kept on errors
+        numbers::parse_error parse_int(int64_t& value) const noexcept {
+            return numbers::parse_int(data(), size(), value);
+        }
+        numbers::parse_error parse_uint(uint64_t& value) const noexcept {
+            return numbers::parse_uint(data(), size(), value);
+        }
+        numbers::parse_error parse_double(double& value) const {
+            return numbers::parse_double(data(), size(), value);
+        }
+
+        // for printing
+        const char* c_str() const noexcept {
+            return data();
+        }
+
+        size_t size() const noexcept {
+            return use_heap() ? _heap._size : _small.size();
+        }
+
+        void resize(size_t new_size, char ch = 0) {
+            auto old_size = size();
+            if (capacity() < new_size) {
+                grow(calc_capacity(new_size));
+            }
+            else if (new_size != old_size) {
+                own_chars();
+            }
+            if (new_size < old_size) {
+                if (use_heap()) {
+                    _heap._data[new_size] = 0;
+                    _heap.set_size(new_size);
+                }
+                else {
+                    _small._buffer[new_size] = 0;
+                    _small.set_size_and_reset_heap_flag(new_size);
+                }
+            }
+            else if (new_size > old_size) {
+                if (use_heap()) {
+                    kernels::fill(_heap._data + old_size, ch, new_size - old_size);
+                    _heap._data[new_size] = 0;
+                    _heap.set_size(new_size);
+                }
+                else {
+                    kernels::fill_inline(_small._buffer + old_size, ch, new_size - old_size);
+                    _small._buffer[new_size] = 0;
+                    _small.set_size_and_reset_heap_flag(new_size);
+                }
+            }
+        }
+
+        // static chars can't take more chars than they have
+        size_t capacity() const noexcept {
+            return !use_heap() ? (size_t)SSO_CAPACITY : is_static() ? _heap._size : _heap.capacity();
+        }
+
+        void reserve(size_t new_capacity) {
+            if (new_capacity > capacity()) {
+                grow(estimate_capacity(new_capacity));
+            }
+        }
+    };
+
+    using string = basic_string<unique_buffers>;
+    using cow_string = basic_string<shared_buffers>;
+
+    static_assert(
+        sizeof(string) == sizeof(small_string_data),
+        "sizeof(string) != sizeof(small_string_data)");
+    static_assert(
+        sizeof(cow_string) == sizeof(small_string_data),
+        "sizeof(cow_string) != sizeof(small_string_data)");
+}
+
+namespace std {
+    template <class Buffers>
+    struct hash<sso4::basic_string<Buffers>> {
+        size_t operator()(const sso4::basic_string<Buffers>& str) const noexcept {
+            return str.hash();
+        }
+    };
+}
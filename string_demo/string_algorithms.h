@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstring>
+#include <cassert>
+
+#include "string_kernels.h"
+#include "string_search.h"
+
+// Helpers working on (pointer, size) ranges shared by the string classes.
+// They never look for '\0', so they work on any part of a string.
+namespace algorithms {
+
+    using search::npos;
+    using search::find;
+
+    // true if ptr points into [data, data + size]
+    inline bool points_into(const char* ptr, const char* data, size_t size) {
+        return data && ptr >= data && ptr <= data + size;
+    }
+
+    // number of non-overlapping occurrences, empty pattern never matches
+    inline size_t count(const char* str, size_t size, const char* pattern, size_t pattern_size) {
+        if (pattern_size == 0) return 0;
+        size_t res = 0;
+        for (auto pos = find(str, size, pattern, pattern_size); pos != npos; pos = find(str, size, pattern, pattern_size, pos + pattern_size)) {
+            ++res;
+        }
+        return res;
+    }
+
+    // Writes src with all occurrences of pattern replaced to dst, returns the end of the result.
+    // dst may overlap src if it does not overtake reading position:
+    // dst <= src when replacement is not longer than pattern,
+    // or src is at the end of the buffer big enough for the result.
+    inline char* replace_all(char* dst, const char* src, size_t size,
+        const char* pattern, size_t pattern_size, const char* replacement, size_t replacement_size) {
+        assert(pattern_size > 0);
+        size_t from = 0;
+        for (auto pos = find(src, size, pattern, pattern_size); pos != npos; pos = find(src, size, pattern, pattern_size, from)) {
+            kernels::move(dst, src + from, pos - from);
+            dst += pos - from;
+            kernels::copy(dst, replacement, replacement_size);
+            dst += replacement_size;
+            from = pos + pattern_size;
+        }
+        kernels::move(dst, src + from, size - from);
+        return dst + size - from;
+    }
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "string_parse.h"
+#include "string_split.h"
+
 namespace api_only {
 
     // Don`t miss the opportunity to become a part of the Intellias team!
@@ -11,6 +14,8 @@ namespace api_only {
     // This interface defines subset of std::string interface we are going to implement
     class string {
     public:
+        static const size_t npos = (size_t)-1;
+
         // default constructed
         string() noexcept;
         // construct from c-string
@@ -26,14 +31,73 @@ namespace api_only {
         // useful and interesting
         void swap(string& other) noexcept;
 
-        // iterators
-        char* begin() noexcept;
-        char* end() noexcept;
+        // iterators, writing through them may copy shared or static chars
+        char* begin();
+        char* end();
 
         // some modifications to have fun
         void insert(size_t index, size_t count, char ch);
         void insert(size_t index, const char* str);
 
+        void erase(size_t index, size_t count);
+        void replace(size_t index, size_t count, const char* str);
+        void replace_all(const char* pattern, const char* replacement);
+
+        // search, returns npos if nothing is found
+        size_t find(char ch, size_t pos = 0) const noexcept;
+        size_t find(const char* str, size_t pos = 0) const noexcept;
+        size_t rfind(char ch, size_t pos = npos) const noexcept;
+        size_t rfind(const char* str, size_t pos = npos) const noexcept;
+        size_t find_first_of(const char* chars, size_t pos = 0) const noexcept;
+        size_t find_first_not_of(const char* chars, size_t pos = 0) const noexcept;
+
+        // comparison
+        int compare(const string& other) const noexcept;
+        friend bool operator==(const string& lhs, const string& rhs) noexcept;
+        friend bool operator!=(const string& lhs, const string& rhs) noexcept;
+        friend bool operator<(const string& lhs, const string& rhs) noexcept;
+        friend bool operator<=(const string& lhs, const string& rhs) noexcept;
+        friend bool operator>(const string& lhs, const string& rhs) noexcept;
+        friend bool operator>=(const string& lhs, const string& rhs) noexcept;
+
+        // ASCII case conversion, other chars are kept, may copy shared or static chars
+        void to_lower();
+        void to_upper();
+
+        // ASCII case-insensitive comparison and matching hash
+        bool iequals(const string& other) const noexcept;
+        int icompare(const string& other) const noexcept;
+        size_t ihash() const noexcept;
+
+        // 32-bit hash of the chars, std::hash uses it
+        size_t hash() const noexcept;
+
+        // UTF-8 checks
+        bool validate_utf8() const noexcept;
+        size_t count_code_points() const noexcept;
+
+        // Levenshtein distance, the bounded one gives up early
+        // and returns max_distance + 1 for farther strings
+        size_t edit_distance(const string& other) const;
+        size_t bounded_edit_distance(const string& other, size_t max_distance) const;
+
+        // zero-copy tokens, valid until the string is modified
+        splitting::range<splitting::char_delimiter> split(char delimiter) const noexcept;
+        splitting::range<splitting::substring_delimiter> split(const char* delimiter) const noexcept;
+        splitting::range<splitting::any_of_delimiter> split_any_of(const char* delimiters) const noexcept;
+
+        // numbers in the shortest form that reads back the same,
+        // no allocations while the result fits the inline buffer
+        template <class Number>
+        static string from_number(Number value);
+        template <class Number>
+        void append_number(Number value);
+
+        // the whole string must be a number, value is kept on errors
+        numbers::parse_error parse_int(int64_t& value) const noexcept;
+        numbers::parse_error parse_uint(uint64_t& value) const noexcept;
+        numbers::parse_error parse_double(double& value) const;
+
         // for printing
         const char* c_str() const noexcept;
 
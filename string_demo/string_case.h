@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+#include "string_hash.h"
+#include "string_kernels.h"
+
+// ASCII case conversion and case-insensitive comparison, other chars are never changed.
+// Ranges shorter than 16 chars are processed as 8-byte words (SWAR):
+// a char is in [first, first + 25] if adding two constants to its low 7 bits
+// sets the high bit of the first sum only, no carry crosses chars.
+// Longer ranges use 16-byte SSE2 blocks, KB-sized ones 32-byte AVX2 blocks
+// if CPU has them. The last block overlaps the previous one,
+// converting a char twice changes nothing.
+namespace ascii {
+
+    const uint64_t ONES = 0x0101010101010101ull;
+    const uint64_t HIGH_BITS = 0x8080808080808080ull;
+
+    // flips case of chars in [first, first + 25]
+    template <char First>
+    inline uint64_t flip_case8(uint64_t word) {
+        auto low_bits = word & ~HIGH_BITS;
+        auto ge_first = low_bits + (0x80 - First) * ONES;
+        auto gt_last = low_bits + (0x80 - First - 26) * ONES;
+        auto in_range = (ge_first ^ gt_last) & ~word & HIGH_BITS;
+        return word ^ (in_range >> 2);
+    }
+
+    inline uint64_t lower8(uint64_t word) {
+        return flip_case8<'A'>(word);
+    }
+
+    inline char lower(char ch) {
+        return ch >= 'A' && ch <= 'Z' ? ch + ('a' - 'A') : ch;
+    }
+
+    // up to 8 chars padded with zeros
+    inline uint64_t load_partial(const char* src, size_t count) {
+        uint64_t res = 0;
+        if (count > 0) {
+            std::memcpy(&res, src, count);
+        }
+        return res;
+    }
+
+    template <char First>
+    inline void flip_case_swar(char* str, size_t size) {
+        if (size < 8) {
+            if (size > 0) {
+                auto word = flip_case8<First>(load_partial(str, size));
+                std::memcpy(str, &word, size);
+            }
+            return;
+        }
+        size_t i = 0;
+        for (; i + 8 < size; i += 8) {
+            kernels::store8(str + i, flip_case8<First>(kernels::load8(str + i)));
+        }
+        kernels::store8(str + size - 8, flip_case8<First>(kernels::load8(str + size - 8)));
+    }
+
+#if HAS_SSE2
+    template <char First>
+    inline __m128i flip_case16(__m128i block) {
+        // chars in range become [-128, -103] as signed
+        auto shifted = _mm_sub_epi8(block, _mm_set1_epi8((char)(First + 128)));
+        auto in_range = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 26));
+        return _mm_xor_si128(block, _mm_and_si128(in_range, _mm_set1_epi8(0x20)));
+    }
+
+    template <char First>
+    inline void flip_case_sse2(char* str, size_t size) {
+        assert(size >= 16);
+        for (size_t i = 0; i + 16 < size; i += 16) {
+            auto ptr = reinterpret_cast<__m128i*>(str + i);
+            _mm_storeu_si128(ptr, flip_case16<First>(_mm_loadu_si128(ptr)));
+        }
+        auto ptr = reinterpret_cast<__m128i*>(str + size - 16);
+        _mm_storeu_si128(ptr, flip_case16<First>(_mm_loadu_si128(ptr)));
+    }
+#endif
+
+#if HAS_AVX2_DISPATCH
+    template <char First>
+    TARGET_AVX2 inline void flip_case_avx2(char* str, size_t size) {
+        assert(size >= 32);
+        const auto offset = _mm256_set1_epi8((char)(First + 128));
+        const auto limit = _mm256_set1_epi8(-128 + 26);
+        const auto flip = _mm256_set1_epi8(0x20);
+        for (size_t i = 0; i < size; i += 32) {
+            auto ptr = reinterpret_cast<__m256i*>(str + (i + 32 <= size ? i : size - 32));
+            auto block = _mm256_loadu_si256(ptr);
+            auto in_range = _mm256_cmpgt_epi8(limit, _mm256_sub_epi8(block, offset));
+            _mm256_storeu_si256(ptr, _mm256_xor_si256(block, _mm256_and_si256(in_range, flip)));
+        }
+    }
+#endif
+
+    template <char First>
+    inline void flip_case(char* str, size_t size) {
+#if HAS_SSE2
+        if (size >= 16) {
+#if HAS_AVX2_DISPATCH
+            static const bool use_avx2 = kernels::cpu_has_avx2();
+            if (size >= kernels::SMALL_SIZE && use_avx2) {
+                flip_case_avx2<First>(str, size);
+                return;
+            }
+#endif
+            flip_case_sse2<First>(str, size);
+            return;
+        }
+#endif
+        flip_case_swar<First>(str, size);
+    }
+
+    inline void to_lower(char* str, size_t size) {
+        flip_case<'A'>(str, size);
+    }
+
+    inline void to_upper(char* str, size_t size) {
+        flip_case<'a'>(str, size);
+    }
+
+    // equal ignoring ASCII case
+    inline bool iequal(const char* a, const char* b, size_t size) {
+        size_t i = 0;
+#if HAS_SSE2
+        if (size >= 16) {
+            for (;; i += 16) {
+                auto last = i + 16 >= size;
+                auto offset = last ? size - 16 : i;
+                auto block_a = flip_case16<'A'>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + offset)));
+                auto block_b = flip_case16<'A'>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + offset)));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(block_a, block_b)) != 0xFFFF) return false;
+                if (last) return true;
+            }
+        }
+#endif
+        for (; i + 8 <= size; i += 8) {
+            if (lower8(kernels::load8(a + i)) != lower8(kernels::load8(b + i))) return false;
+        }
+        return lower8(load_partial(a + i, size - i)) == lower8(load_partial(b + i, size - i));
+    }
+
+    // three-way comparison of lower case chars
+    inline int icompare(const char* a, const char* b, size_t size) {
+        for (size_t i = 0; i < size; i += 8) {
+            auto count = size - i < 8 ? size - i : 8;
+            auto x = lower8(load_partial(a + i, count));
+            auto y = lower8(load_partial(b + i, count));
+            if (x != y) {
+                // the lowest different byte is the first different char
+                auto index = kernels::count_trailing_zeros64(x ^ y) / 8;
+                return (int)((x >> index * 8) & 0xFF) - (int)((y >> index * 8) & 0xFF);
+            }
+        }
+        return 0;
+    }
+
+    struct lower_reader {
+        static uint64_t load8(const char* src) {
+            return lower8(kernels::load8(src));
+        }
+        static uint32_t load4(const char* src) {
+            return (uint32_t)lower8(kernels::load4(src));
+        }
+        static unsigned char load1(const char* src) {
+            return (unsigned char)lower(*src);
+        }
+    };
+
+    // hashing::hash32 of the lower case string
+    inline uint32_t ihash32(const char* str, size_t size) {
+        auto res = hashing::hash_with<lower_reader>(str, size, 0);
+        return (uint32_t)(res ^ (res >> 32));
+    }
+}
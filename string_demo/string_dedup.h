@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "const_string.h"
+#include "sso_string4.h"
+#include "string_hash.h"
+#include "string_kernels.h"
+
+// Deduplication of strings by content for bulk loads: every distinct value
+// is kept once as a shared string, duplicates get copies of its handle.
+// Values that fit the inline buffer of sso4::string are returned as inline
+// sso4 strings and never enter the table. The table keeps its chars within a budget,
+// values that don't fit are returned as shared strings of their own.
+// Not thread-safe, one table is filled by one loader.
+namespace dedup {
+
+    // a loaded value, an inline sso4 string or a shared string for longer values
+    template <class RefCount = shared::atomic_refcount>
+    class basic_value {
+        using const_string = shared::basic_const_string<RefCount>;
+
+        sso4::string _inline;
+        const_string _shared;       // empty for inline values
+
+    public:
+        enum { INLINE_CAPACITY = sso4::SSO_CAPACITY };
+
+        basic_value() noexcept {}
+
+        basic_value(const char* str, size_t size) {
+            assert(size <= INLINE_CAPACITY);
+            _inline.resize(size);
+            kernels::copy(_inline.begin(), str, size);
+        }
+
+        explicit basic_value(const_string str) noexcept : _shared(std::move(str)) {}
+
+        bool is_inline() const noexcept {
+            return _shared.empty();
+        }
+
+        const char* c_str() const noexcept {
+            return is_inline() ? _inline.c_str() : _shared.c_str();
+        }
+
+        size_t size() const noexcept {
+            return is_inline() ? _inline.size() : _shared.size();
+        }
+
+        size_t hash() const noexcept {
+            return is_inline() ? _inline.hash() : _shared.hash();
+        }
+
+        // values sharing the chars, the table included, 1 for inline values
+        size_t use_count() const noexcept {
+            return is_inline() ? 1 : _shared.use_count();
+        }
+
+        // empty for inline values
+        const const_string& shared() const noexcept {
+            return _shared;
+        }
+
+        friend bool operator==(const basic_value& lhs, const basic_value& rhs) noexcept {
+            auto size = lhs.size();
+            return size == rhs.size() && kernels::equal(lhs.c_str(), rhs.c_str(), size);
+        }
+        friend bool operator!=(const basic_value& lhs, const basic_value& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+    };
+
+    using value = basic_value<>;
+
+    struct stats {
+        size_t strings;         // all values added
+        size_t inline_strings;  // values returned as inline sso4 strings
+        size_t bytes;           // chars of values that are not inline
+        size_t unique_bytes;    // chars kept by the table
+        size_t unshared_bytes;  // chars of values that did not fit the budget
+
+        // chars of loaded values per char kept in memory, 1 if nothing was shared
+        double ratio() const noexcept {
+            auto kept = unique_bytes + unshared_bytes;
+            return kept ? (double)bytes / kept : 1.0;
+        }
+    };
+
+    template <class RefCount = shared::atomic_refcount>
+    class table {
+        using const_string = shared::basic_const_string<RefCount>;
+        using value = basic_value<RefCount>;
+
+        enum { MIN_INDEX_SIZE = 64 };
+
+        size_t _budget;
+        std::vector<const_string> _strings;
+        std::vector<uint64_t> _index;       // hash << 32 | (position in _strings + 1), 0 is free
+        stats _stats;
+
+        void insert_index(uint64_t slot) noexcept {
+            const auto mask = _index.size() - 1;
+            auto i = (size_t)(slot >> 32) & mask;
+            while (_index[i] != 0) {
+                i = (i + 1) & mask;
+            }
+            _index[i] = slot;
+        }
+
+        void grow_index() {
+            std::vector<uint64_t> old(_index.size() * 2, 0);
+            old.swap(_index);
+            for (auto slot : old) {
+                if (slot != 0) insert_index(slot);
+            }
+        }
+
+        // position of a free slot if the value is new
+        const const_string* find(const char* str, size_t size, uint32_t hash, size_t& free_slot) const noexcept {
+            const auto mask = _index.size() - 1;
+            auto i = (size_t)hash & mask;
+            for (; _index[i] != 0; i = (i + 1) & mask) {
+                auto slot = _index[i];
+                if ((uint32_t)(slot >> 32) != hash) continue;
+                auto& candidate = _strings[(size_t)(uint32_t)slot - 1];
+                if (candidate.size() == size && kernels::equal(candidate.c_str(), str, size)) {
+                    return &candidate;
+                }
+            }
+            free_slot = i;
+            return nullptr;
+        }
+
+        value add_inline(const char* str, size_t size) {
+            ++_stats.strings;
+            ++_stats.inline_strings;
+            return value(str, size);
+        }
+
+        // make builds the shared string of a new value
+        template <class Make>
+        value add_shared(const char* str, size_t size, uint32_t hash, Make make) {
+            ++_stats.strings;
+            _stats.bytes += size;
+            size_t free_slot;
+            if (auto found = find(str, size, hash, free_slot)) {
+                return value(*found);
+            }
+            if (_stats.unique_bytes + size > _budget) {
+                _stats.unshared_bytes += size;
+                return value(make());
+            }
+            _stats.unique_bytes += size;
+            _strings.push_back(make());
+            _index[free_slot] = ((uint64_t)hash << 32) | _strings.size();
+            if (2 * _strings.size() > _index.size()) {
+                grow_index();
+            }
+            return value(_strings.back());
+        }
+
+    public:
+        // budget is the number of chars the table may keep
+        explicit table(size_t budget = (size_t)-1) : _budget(budget), _index(MIN_INDEX_SIZE, 0), _stats() {}
+
+        value add(const char* str, size_t size) {
+            if (size <= value::INLINE_CAPACITY) return add_inline(str, size);
+            return add_shared(str, size, hashing::hash32(str, size), [=] { return const_string(str, size); });
+        }
+
+        // sso3 and sso4 strings give their cached hash
+        template <class String>
+        value add(const String& str) {
+            auto data = str.c_str();
+            auto size = str.size();
+            if (size <= value::INLINE_CAPACITY) return add_inline(data, size);
+            return add_shared(data, size, (uint32_t)str.hash(), [=] { return const_string(data, size); });
+        }
+
+        // a new value takes the heap buffer of str if it can, str is left empty
+        value add(shared::mutable_string&& str) {
+            auto data = str.c_str();
+            auto size = str.size();
+            auto res = size <= value::INLINE_CAPACITY
+                ? add_inline(data, size)
+                : add_shared(data, size, (uint32_t)str.hash(), [&] { return shared::make_const<RefCount>(std::move(str)); });
+            str = shared::mutable_string();
+            return res;
+        }
+
+        // number of distinct values kept
+        size_t size() const noexcept {
+            return _strings.size();
+        }
+
+        const stats& report() const noexcept {
+            return _stats;
+        }
+
+        // the table forgets its values and the report, strings returned before stay valid
+        void clear() {
+            _strings.clear();
+            std::vector<uint64_t>(MIN_INDEX_SIZE, 0).swap(_index);
+            _stats = stats();
+        }
+    };
+}
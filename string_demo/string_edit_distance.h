@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "string_kernels.h"
+
+// Levenshtein distance with bit vectors (Myers, Hyyro): a column of the
+// distance matrix is kept as two words of +1 / -1 vertical differences,
+// one text char updates 64 rows with a dozen word operations.
+// Patterns up to 64 chars take one word, longer ones a chain of words
+// passing the horizontal difference of their last row to the next word.
+// Pairs are compared after common prefix and suffix are dropped, the shorter string
+// is the pattern. Bounded versions stop as soon as the bound can't be met.
+namespace levenshtein {
+
+    const size_t npos = (size_t)-1;
+
+    inline size_t common_prefix(const char* a, const char* b, size_t size) {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            auto diff = kernels::load8(a + i) ^ kernels::load8(b + i);
+            if (diff) return i + kernels::count_trailing_zeros64(diff) / 8;
+        }
+        while (i < size && a[i] == b[i]) ++i;
+        return i;
+    }
+
+    // common chars before a_end and b_end
+    inline size_t common_suffix(const char* a_end, const char* b_end, size_t size) {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            auto diff = kernels::load8(a_end - i - 8) ^ kernels::load8(b_end - i - 8);
+            if (diff) return i + (63 - kernels::highest_bit64(diff)) / 8;
+        }
+        while (i < size && *(a_end - 1 - i) == *(b_end - 1 - i)) ++i;
+        return i;
+    }
+
+    // the final distance is at least the current one minus chars left
+    inline bool out_of_bound(size_t score, size_t chars_left, size_t max_distance) {
+        return score > chars_left && score - chars_left > max_distance;
+    }
+
+    inline size_t bounded(size_t distance, size_t max_distance) {
+        return distance <= max_distance ? distance : max_distance + 1;
+    }
+
+    // pattern of 1..64 chars, bit i of peq[ch] is set if pattern[i] == ch
+    inline size_t myers64(const uint64_t* peq, size_t pattern_size, const char* text, size_t text_size, size_t max_distance) {
+        const uint64_t last = 1ull << (pattern_size - 1);
+        uint64_t pv = ~0ull;
+        uint64_t mv = 0;
+        size_t score = pattern_size;
+        for (size_t j = 0; j < text_size; ++j) {
+            auto eq = peq[(unsigned char)text[j]];
+            auto xv = eq | mv;
+            auto xh = (((eq & pv) + pv) ^ pv) | eq;
+            auto ph = mv | ~(xh | pv);
+            auto mh = pv & xh;
+            if (ph & last) {
+                ++score;
+            }
+            else if (mh & last) {
+                --score;
+            }
+            // the first row grows by one per char
+            ph = (ph << 1) | 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+            if (out_of_bound(score, text_size - j - 1, max_distance)) return max_distance + 1;
+        }
+        return bounded(score, max_distance);
+    }
+
+    // pattern of any size, peq[ch * blocks + block] keeps 64 rows of a char
+    inline size_t myers_blocks(const uint64_t* peq, size_t pattern_size, const char* text, size_t text_size, size_t max_distance) {
+        const size_t blocks = (pattern_size + 63) / 64;
+        const uint64_t last = 1ull << ((pattern_size - 1) % 64);
+        const uint64_t high = 1ull << 63;
+        std::vector<uint64_t> pv(blocks, ~0ull);
+        std::vector<uint64_t> mv(blocks, 0);
+        size_t score = pattern_size;
+        for (size_t j = 0; j < text_size; ++j) {
+            auto eqs = peq + (unsigned char)text[j] * blocks;
+            int carry = 1;
+            for (size_t b = 0; b < blocks; ++b) {
+                auto eq = eqs[b];
+                auto xv = eq | mv[b];
+                // -1 coming from the block above acts as a match in the first row
+                const uint64_t carry_minus = carry < 0;
+                eq |= carry_minus;
+                auto xh = (((eq & pv[b]) + pv[b]) ^ pv[b]) | eq;
+                auto ph = mv[b] | ~(xh | pv[b]);
+                auto mh = pv[b] & xh;
+                auto out = b + 1 == blocks ? last : high;
+                auto next_carry = (ph & out) ? 1 : (mh & out) ? -1 : 0;
+                ph = (ph << 1) | (uint64_t)(carry > 0);
+                mh = (mh << 1) | carry_minus;
+                pv[b] = mh | ~(xv | ph);
+                mv[b] = ph & xv;
+                carry = next_carry;
+            }
+            score += carry;
+            if (out_of_bound(score, text_size - j - 1, max_distance)) return max_distance + 1;
+        }
+        return bounded(score, max_distance);
+    }
+
+    // a string compared with many others, its bit vectors are built once
+    class query {
+        size_t _size;
+        size_t _blocks;
+        std::vector<uint64_t> _peq;
+
+    public:
+        query(const char* str, size_t size)
+            : _size(size), _blocks((size + 63) / 64), _peq(256 * _blocks) {
+            for (size_t i = 0; i < size; ++i) {
+                _peq[(unsigned char)str[i] * _blocks + i / 64] |= 1ull << (i % 64);
+            }
+        }
+
+        size_t size() const noexcept {
+            return _size;
+        }
+
+        // distances above max_distance are reported as max_distance + 1
+        size_t distance(const char* text, size_t text_size, size_t max_distance = npos) const {
+            auto diff = _size > text_size ? _size - text_size : text_size - _size;
+            if (diff > max_distance) return max_distance + 1;
+            if (_size == 0) return text_size;
+            if (_blocks == 1) return myers64(_peq.data(), _size, text, text_size, max_distance);
+            return myers_blocks(_peq.data(), _size, text, text_size, max_distance);
+        }
+
+        // candidates is a range of strings with c_str() and size()
+        template <class Strings>
+        std::vector<size_t> distances(const Strings& candidates, size_t max_distance = npos) const {
+            std::vector<size_t> res;
+            for (auto& candidate : candidates) {
+                res.push_back(distance(candidate.c_str(), candidate.size(), max_distance));
+            }
+            return res;
+        }
+    };
+
+    // distances above max_distance are reported as max_distance + 1
+    inline size_t distance(const char* a, size_t a_size, const char* b, size_t b_size, size_t max_distance = npos) {
+        auto prefix = common_prefix(a, b, std::min(a_size, b_size));
+        a += prefix;
+        b += prefix;
+        a_size -= prefix;
+        b_size -= prefix;
+        auto suffix = common_suffix(a + a_size, b + b_size, std::min(a_size, b_size));
+        a_size -= suffix;
+        b_size -= suffix;
+        if (a_size > b_size) {
+            std::swap(a, b);
+            std::swap(a_size, b_size);
+        }
+        if (b_size - a_size > max_distance) return max_distance + 1;
+        if (a_size == 0) return b_size;
+        if (a_size > 64) return query(a, a_size).distance(b, b_size, max_distance);
+
+        // only entries of chars present in the strings are read
+        uint64_t peq[256];
+        for (size_t j = 0; j < b_size; ++j) {
+            peq[(unsigned char)b[j]] = 0;
+        }
+        for (size_t i = 0; i < a_size; ++i) {
+            peq[(unsigned char)a[i]] = 0;
+        }
+        for (size_t i = 0; i < a_size; ++i) {
+            peq[(unsigned char)a[i]] |= 1ull << i;
+        }
+        return myers64(peq, a_size, b, b_size, max_distance);
+    }
+}
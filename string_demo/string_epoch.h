@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Epoch-based reclamation for strings and tables of strings that many threads
+// read while writers replace them. A reader enters a guard, which stores the
+// global epoch in the reader's own record, and then reads through plain pointers:
+// no reference counts are touched and nothing shared with other threads is written.
+// A writer swaps a pointer and retires the old object with the current epoch,
+// the epoch advances, and the object is deleted once no reader is in a guard
+// entered before that, so readers never see freed chars.
+//     epochs::atomic_ptr<std::vector<shared::const_string>> table;
+//     reader: epochs::guard guard; auto values = table.load(guard);
+//     writer: table.store(std::move(new_table));  // std::unique_ptr
+namespace epochs {
+
+    class reader;
+
+    class domain {
+        friend class reader;
+
+        struct record {
+            std::atomic<uint64_t> epoch;    // 0 outside guards
+            std::atomic<bool> in_use;
+            record* next;
+            char padding[64];               // records of different threads don't share cache lines
+
+            record() noexcept : epoch(0), in_use(true), next(nullptr) {}
+        };
+
+        struct retired {
+            void* ptr;
+            void (*deleter)(void*);
+            uint64_t epoch;                 // epoch before the object was retired
+        };
+
+        enum { MIN_COLLECT_SIZE = 64 };
+
+        std::atomic<uint64_t> _epoch;
+        std::atomic<record*> _records;      // append-only list, records are reused
+
+        // below are guarded by _mutex
+        std::mutex _mutex;
+        std::vector<retired> _retired;
+        size_t _collect_size;
+
+        // records of finished readers are reused
+        record* acquire_record() {
+            for (auto rec = _records.load(std::memory_order_acquire); rec; rec = rec->next) {
+                bool expected = false;
+                if (!rec->in_use.load(std::memory_order_relaxed)
+                    && rec->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    return rec;
+                }
+            }
+            auto rec = new record();
+            auto head = _records.load(std::memory_order_relaxed);
+            do {
+                rec->next = head;
+            } while (!_records.compare_exchange_weak(head, rec, std::memory_order_release, std::memory_order_relaxed));
+            return rec;
+        }
+
+        void release_record(record* rec) noexcept {
+            rec->epoch.store(0, std::memory_order_release);
+            rec->in_use.store(false, std::memory_order_release);
+        }
+
+        // _mutex is locked, moves objects no reader can see to ready
+        void take_ready(std::vector<retired>& ready) {
+            // pointers were swapped before the scan, a reader that is not seen here
+            // publishes its epoch before its loads and gets the new pointers
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto oldest = UINT64_MAX;
+            for (auto rec = _records.load(std::memory_order_acquire); rec; rec = rec->next) {
+                auto epoch = rec->epoch.load(std::memory_order_acquire);
+                if (epoch != 0 && epoch < oldest) oldest = epoch;
+            }
+            size_t kept = 0;
+            for (auto& item : _retired) {
+                if (item.epoch < oldest) {
+                    ready.push_back(item);
+                }
+                else {
+                    _retired[kept++] = item;
+                }
+            }
+            _retired.resize(kept);
+            _collect_size = std::max<size_t>(MIN_COLLECT_SIZE, 2 * kept);
+        }
+
+        static void destroy(std::vector<retired>& ready) noexcept {
+            for (auto& item : ready) {
+                item.deleter(item.ptr);
+            }
+        }
+
+    public:
+        domain() : _epoch(1), _records(nullptr), _collect_size(MIN_COLLECT_SIZE) {}
+
+        domain(const domain&) = delete;
+        domain& operator=(const domain&) = delete;
+
+        // no reader may be in a guard any more
+        ~domain() {
+            destroy(_retired);
+            auto rec = _records.load(std::memory_order_acquire);
+            while (rec) {
+                auto next = rec->next;
+                delete rec;
+                rec = next;
+            }
+        }
+
+        // deleter(ptr) is called when no reader can see ptr, the caller has already unlinked it
+        void retire(void* ptr, void (*deleter)(void*)) {
+            if (!ptr) return;
+            std::vector<retired> ready;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _retired.push_back(retired{ ptr, deleter, _epoch.fetch_add(1, std::memory_order_acq_rel) });
+                if (_retired.size() >= _collect_size) {
+                    take_ready(ready);
+                }
+            }
+            destroy(ready);
+        }
+
+        template <class T>
+        void retire(const T* ptr) {
+            retire(const_cast<T*>(ptr), [](void* p) { delete static_cast<T*>(p); });
+        }
+
+        // deletes what no reader can see, returns the number of deleted objects
+        size_t collect() {
+            std::vector<retired> ready;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                take_ready(ready);
+            }
+            destroy(ready);
+            return ready.size();
+        }
+
+        // waits until every retired object is deleted, the caller must not be in a guard
+        void synchronize() {
+            while (collect(), pending() > 0) {
+                std::this_thread::yield();
+            }
+        }
+
+        // objects retired and not deleted yet
+        size_t pending() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _retired.size();
+        }
+    };
+
+    // a thread in a domain, used by one thread at a time
+    class reader {
+        domain& _domain;
+        domain::record* _record;
+        unsigned _depth;
+
+    public:
+        explicit reader(domain& owner) : _domain(owner), _record(owner.acquire_record()), _depth(0) {}
+
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+
+        ~reader() {
+            _domain.release_record(_record);
+        }
+
+        // guards may be nested, the outermost one publishes the epoch
+        void enter() noexcept {
+            if (_depth++ == 0) {
+                _record->epoch.store(_domain._epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        void leave() noexcept {
+            if (--_depth == 0) {
+                _record->epoch.store(0, std::memory_order_release);
+            }
+        }
+    };
+
+    inline domain& global_domain() {
+        static domain res;
+        return res;
+    }
+
+    inline reader& thread_reader() {
+        thread_local reader res(global_domain());
+        return res;
+    }
+
+    // pointers loaded inside a guard stay valid until it ends
+    class guard {
+        reader& _reader;
+
+    public:
+        explicit guard(reader& owner = thread_reader()) : _reader(owner) {
+            _reader.enter();
+        }
+
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+
+        ~guard() {
+            _reader.leave();
+        }
+    };
+
+    // immutable object replaced by writers, readers load it inside a guard of the same domain
+    template <class T>
+    class atomic_ptr {
+        std::atomic<const T*> _ptr;
+        domain& _domain;
+
+    public:
+        explicit atomic_ptr(std::unique_ptr<T> value = nullptr, domain& owner = global_domain()) noexcept
+            : _ptr(value.release()), _domain(owner) {}
+
+        atomic_ptr(const atomic_ptr&) = delete;
+        atomic_ptr& operator=(const atomic_ptr&) = delete;
+
+        ~atomic_ptr() {
+            _domain.retire(_ptr.load(std::memory_order_relaxed));
+        }
+
+        const T* load(const guard&) const noexcept {
+            return _ptr.load(std::memory_order_acquire);
+        }
+
+        // the old object is retired
+        void store(std::unique_ptr<T> value) {
+            _domain.retire(_ptr.exchange(value.release(), std::memory_order_acq_rel));
+        }
+    };
+}
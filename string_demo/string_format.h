@@ -0,0 +1,340 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <type_traits>
+
+#include "string_hash.h"
+#include "string_number_tables.h"
+
+// Number to chars conversion without allocations or locales, like C++17 std::to_chars.
+// Integers are written two digits at a time from a 200-char table.
+// Floating point numbers get the shortest digits that parse back to the same value (Ryu):
+// the bounds of the rounding interval are scaled by a power of 10 taken from
+// 125-bit tables, digits are removed while the bounds still differ.
+// Like std::to_chars fixed or scientific form is chosen, whichever is shorter.
+namespace numbers {
+
+    // enough for any integer and the longest shortest double "-2.2250738585072014e-308"
+    enum { MAX_CHARS = 32 };
+
+    const char DIGIT_PAIRS[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    inline size_t count_digits(uint64_t value) {
+        size_t res = 1;
+        for (;;) {
+            if (value < 10) return res;
+            if (value < 100) return res + 1;
+            if (value < 1000) return res + 2;
+            if (value < 10000) return res + 3;
+            value /= 10000;
+            res += 4;
+        }
+    }
+
+    // writes exactly count digits of value ending at dst + count
+    inline void write_digits(char* dst, uint64_t value, size_t count) {
+        auto end = dst + count;
+        while (value >= 100) {
+            auto pair = (size_t)(value % 100) * 2;
+            value /= 100;
+            end -= 2;
+            std::memcpy(end, DIGIT_PAIRS + pair, 2);
+        }
+        if (value >= 10) {
+            end -= 2;
+            std::memcpy(end, DIGIT_PAIRS + value * 2, 2);
+        }
+        else {
+            *--end = (char)('0' + value);
+        }
+        assert(end == dst);
+    }
+
+    inline size_t format_unsigned(char* dst, uint64_t value) {
+        auto count = count_digits(value);
+        write_digits(dst, value, count);
+        return count;
+    }
+
+    inline size_t format_signed(char* dst, int64_t value) {
+        if (value >= 0) return format_unsigned(dst, (uint64_t)value);
+        *dst = '-';
+        return 1 + format_unsigned(dst + 1, 0 - (uint64_t)value);
+    }
+
+    inline uint32_t pow5bits(int32_t e) {
+        return (uint32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+    }
+
+    inline int32_t log10_pow2(int32_t e) {
+        return (int32_t)(((uint32_t)e * 78913) >> 18);
+    }
+
+    inline int32_t log10_pow5(int32_t e) {
+        return (int32_t)(((uint32_t)e * 732923) >> 20);
+    }
+
+    inline bool multiple_of_pow5(uint64_t value, int32_t p) {
+        int32_t count = 0;
+        while (value % 5 == 0) {
+            value /= 5;
+            ++count;
+        }
+        return count >= p;
+    }
+
+    inline bool multiple_of_pow2(uint64_t value, int32_t p) {
+        return (value & ((1ull << p) - 1)) == 0;
+    }
+
+    // (m * mul) >> j for a 125-bit mul, the result fits 64 bits
+    inline uint64_t mul_shift(uint64_t m, const uint64_t* mul, int32_t j) {
+        assert(j > 64 && j < 128);
+        uint64_t low0 = m, high0 = mul[0];
+        hashing::multiply(low0, high0);
+        uint64_t low1 = m, high1 = mul[1];
+        hashing::multiply(low1, high1);
+        auto low = low1 + high0;
+        auto high = high1 + (low < high0);
+        auto shift = j - 64;
+        return (high << (64 - shift)) | (low >> shift);
+    }
+
+    // digits * 10^exponent
+    struct decimal {
+        uint64_t digits;
+        int32_t exponent;
+    };
+
+    // Ryu for any binary format with mantissa fitting 61 bits
+    inline decimal shortest(uint64_t mantissa, uint32_t biased_exponent, int mantissa_bits, int bias) {
+        int32_t e2;
+        uint64_t m2;
+        if (biased_exponent == 0) {
+            e2 = 1 - bias - mantissa_bits - 2;
+            m2 = mantissa;
+        }
+        else {
+            e2 = (int32_t)biased_exponent - bias - mantissa_bits - 2;
+            m2 = (1ull << mantissa_bits) | mantissa;
+        }
+        const bool accept_bounds = (m2 & 1) == 0;
+
+        // the interval of numbers rounding to the value is (mm, mp) * 2^e2
+        const uint64_t mv = 4 * m2;
+        const uint32_t mm_shift = mantissa != 0 || biased_exponent <= 1;
+        uint64_t vr, vp, vm;
+        int32_t e10;
+        bool vm_trailing_zeros = false;
+        bool vr_trailing_zeros = false;
+        if (e2 >= 0) {
+            auto q = log10_pow2(e2) - (e2 > 3);
+            e10 = q;
+            auto k = (int32_t)POW5_INV_BITCOUNT + (int32_t)pow5bits(q) - 1;
+            auto i = -e2 + q + k;
+            vr = mul_shift(mv, POW5_INV_SPLIT[q], i);
+            vp = mul_shift(mv + 2, POW5_INV_SPLIT[q], i);
+            vm = mul_shift(mv - 1 - mm_shift, POW5_INV_SPLIT[q], i);
+            if (q <= 21) {
+                // only one of mp, mv, mm can be a multiple of 5
+                if (mv % 5 == 0) {
+                    vr_trailing_zeros = multiple_of_pow5(mv, q);
+                }
+                else if (accept_bounds) {
+                    vm_trailing_zeros = multiple_of_pow5(mv - 1 - mm_shift, q);
+                }
+                else {
+                    vp -= multiple_of_pow5(mv + 2, q);
+                }
+            }
+        }
+        else {
+            auto q = log10_pow5(-e2) - (-e2 > 1);
+            e10 = q + e2;
+            auto i = -e2 - q;
+            auto k = (int32_t)pow5bits(i) - (int32_t)POW5_BITCOUNT;
+            auto j = q - k;
+            vr = mul_shift(mv, POW5_SPLIT[i], j);
+            vp = mul_shift(mv + 2, POW5_SPLIT[i], j);
+            vm = mul_shift(mv - 1 - mm_shift, POW5_SPLIT[i], j);
+            if (q <= 1) {
+                // mv has at least q trailing zero bits
+                vr_trailing_zeros = true;
+                if (accept_bounds) {
+                    vm_trailing_zeros = mm_shift == 1;
+                }
+                else {
+                    --vp;
+                }
+            }
+            else if (q < 63) {
+                vr_trailing_zeros = multiple_of_pow2(mv, q);
+            }
+        }
+
+        // remove digits while the bounds differ
+        int32_t removed = 0;
+        uint64_t output;
+        if (vm_trailing_zeros || vr_trailing_zeros) {
+            uint32_t last_removed = 0;
+            while (vp / 10 > vm / 10) {
+                vm_trailing_zeros &= vm % 10 == 0;
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = (uint32_t)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                ++removed;
+            }
+            if (vm_trailing_zeros) {
+                while (vm % 10 == 0) {
+                    vr_trailing_zeros &= last_removed == 0;
+                    last_removed = (uint32_t)(vr % 10);
+                    vr /= 10;
+                    vp /= 10;
+                    vm /= 10;
+                    ++removed;
+                }
+            }
+            if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) {
+                // exactly in the middle, round to even
+                last_removed = 4;
+            }
+            output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+        }
+        else {
+            // the common case, no exact halves
+            bool round_up = false;
+            while (vp / 100 > vm / 100) {
+                round_up = vr % 100 >= 50;
+                vr /= 100;
+                vp /= 100;
+                vm /= 100;
+                removed += 2;
+            }
+            while (vp / 10 > vm / 10) {
+                round_up = vr % 10 >= 5;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                ++removed;
+            }
+            output = vr + (vr == vm || round_up);
+        }
+        return decimal{ output, e10 + removed };
+    }
+
+    // digits * 10^exponent in fixed or scientific form, whichever is shorter
+    inline size_t format_decimal(char* dst, decimal value) {
+        auto count = (int32_t)count_digits(value.digits);
+        auto exponent = value.exponent;
+        auto scientific_exponent = exponent + count - 1;
+        auto abs_exponent = scientific_exponent < 0 ? -scientific_exponent : scientific_exponent;
+        auto scientific_size = count + (count > 1) + 2 + (abs_exponent >= 100 ? 3 : 2);
+        auto fixed_size = exponent >= 0 ? count + exponent
+            : -exponent < count ? count + 1
+            : 2 - exponent;
+
+        if (fixed_size <= scientific_size) {
+            if (exponent >= 0) {
+                write_digits(dst, value.digits, count);
+                std::memset(dst + count, '0', exponent);
+            }
+            else if (-exponent < count) {
+                auto integer_count = count + exponent;
+                write_digits(dst + 1, value.digits, count);
+                std::memmove(dst, dst + 1, integer_count);
+                dst[integer_count] = '.';
+            }
+            else {
+                dst[0] = '0';
+                dst[1] = '.';
+                std::memset(dst + 2, '0', -exponent - count);
+                write_digits(dst + 2 - exponent - count, value.digits, count);
+            }
+            return (size_t)fixed_size;
+        }
+
+        // d.ddde+XX, at least two exponent digits like printf
+        write_digits(dst + 1, value.digits, count);
+        dst[0] = dst[1];
+        size_t pos = 1;
+        if (count > 1) {
+            dst[1] = '.';
+            pos = count + 1;
+        }
+        dst[pos++] = 'e';
+        dst[pos++] = scientific_exponent < 0 ? '-' : '+';
+        if (abs_exponent >= 100) {
+            dst[pos++] = (char)('0' + abs_exponent / 100);
+            abs_exponent %= 100;
+        }
+        std::memcpy(dst + pos, DIGIT_PAIRS + abs_exponent * 2, 2);
+        return pos + 2;
+    }
+
+    template <class Bits>
+    inline size_t format_binary(char* dst, Bits bits, int mantissa_bits, int exponent_bits) {
+        const auto mantissa = (uint64_t)(bits & (((Bits)1 << mantissa_bits) - 1));
+        const auto biased_exponent = (uint32_t)((bits >> mantissa_bits) & ((1u << exponent_bits) - 1));
+        const bool negative = (bits >> (mantissa_bits + exponent_bits)) != 0;
+        size_t pos = 0;
+        if (negative) dst[pos++] = '-';
+        if (biased_exponent == (1u << exponent_bits) - 1) {
+            std::memcpy(dst + pos, mantissa ? "nan" : "inf", 3);
+            return pos + 3;
+        }
+        if (biased_exponent == 0 && mantissa == 0) {
+            dst[pos] = '0';
+            return pos + 1;
+        }
+        auto bias = (1 << (exponent_bits - 1)) - 1;
+        return pos + format_decimal(dst + pos, shortest(mantissa, biased_exponent, mantissa_bits, bias));
+    }
+
+    inline size_t format_double(char* dst, double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return format_binary(dst, bits, 52, 11);
+    }
+
+    inline size_t format_float(char* dst, float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return format_binary(dst, bits, 23, 8);
+    }
+
+    // writes value to dst that has room for MAX_CHARS, returns the number of chars,
+    // no terminating zero is written
+    template <class Number>
+    inline typename std::enable_if<std::is_integral<Number>::value && std::is_signed<Number>::value, size_t>::type
+    format(char* dst, Number value) {
+        return format_signed(dst, (int64_t)value);
+    }
+
+    template <class Number>
+    inline typename std::enable_if<std::is_integral<Number>::value && !std::is_signed<Number>::value, size_t>::type
+    format(char* dst, Number value) {
+        return format_unsigned(dst, (uint64_t)value);
+    }
+
+    inline size_t format(char* dst, double value) {
+        return format_double(dst, value);
+    }
+
+    inline size_t format(char* dst, float value) {
+        return format_float(dst, value);
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "string_kernels.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// wyhash style hash: 64x64->128 bit multiplications folded to 64 bits.
+// Up to 16 chars are read with two overlapping loads, no loops,
+// so small strings are hashed straight from their inline buffers.
+// The value does not depend on where chars are stored,
+// equal strings of any class have equal hashes.
+namespace hashing {
+
+    const uint64_t P0 = 0xa0761d6478bd642full;
+    const uint64_t P1 = 0xe7037ed1a0b428dbull;
+    const uint64_t P2 = 0x8ebc6af09c88c6e3ull;
+    const uint64_t P3 = 0x589965cc75374cc3ull;
+
+    // a * b as 128 bit number, low half goes to a, high half to b
+    inline void multiply(uint64_t& a, uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+        auto res = (unsigned __int128)a * b;
+        a = (uint64_t)res;
+        b = (uint64_t)(res >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        a = _umul128(a, b, &b);
+#else
+        uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+        uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+        uint64_t mid = (ll >> 32) + (uint32_t)hl + (uint32_t)lh;
+        a = (mid << 32) | (uint32_t)ll;
+        b = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+#endif
+    }
+
+    inline uint64_t mix(uint64_t a, uint64_t b) {
+        multiply(a, b);
+        return a ^ b;
+    }
+
+    // reads chars as they are
+    struct plain_reader {
+        static uint64_t load8(const char* src) {
+            return kernels::load8(src);
+        }
+        static uint32_t load4(const char* src) {
+            return kernels::load4(src);
+        }
+        static unsigned char load1(const char* src) {
+            return (unsigned char)*src;
+        }
+    };
+
+    // Reader may transform loaded chars, e.g. to hash a string ignoring case
+    template <class Reader>
+    inline uint64_t hash_with(const char* str, size_t size, uint64_t seed) {
+        seed ^= mix(seed ^ P0, P1);
+        uint64_t a, b;
+        if (size <= 16) {
+            if (size >= 4) {
+                // the same four loads cover 4..8 and 9..16 chars
+                auto shift = (size >> 3) << 2;
+                a = ((uint64_t)Reader::load4(str) << 32) | Reader::load4(str + shift);
+                b = ((uint64_t)Reader::load4(str + size - 4) << 32) | Reader::load4(str + size - 4 - shift);
+            }
+            else if (size > 0) {
+                a = ((uint64_t)Reader::load1(str) << 16)
+                    | ((uint64_t)Reader::load1(str + (size >> 1)) << 8)
+                    | Reader::load1(str + size - 1);
+                b = 0;
+            }
+            else {
+                a = b = 0;
+            }
+        }
+        else {
+            auto rest = size;
+            if (rest > 48) {
+                auto seed1 = seed;
+                auto seed2 = seed;
+                do {
+                    seed = mix(Reader::load8(str) ^ P1, Reader::load8(str + 8) ^ seed);
+                    seed1 = mix(Reader::load8(str + 16) ^ P2, Reader::load8(str + 24) ^ seed1);
+                    seed2 = mix(Reader::load8(str + 32) ^ P3, Reader::load8(str + 40) ^ seed2);
+                    str += 48;
+                    rest -= 48;
+                } while (rest > 48);
+                seed ^= seed1 ^ seed2;
+            }
+            while (rest > 16) {
+                seed = mix(Reader::load8(str) ^ P1, Reader::load8(str + 8) ^ seed);
+                str += 16;
+                rest -= 16;
+            }
+            // the last 16 chars, may overlap already hashed ones
+            a = Reader::load8(str + rest - 16);
+            b = Reader::load8(str + rest - 8);
+        }
+        a ^= P1;
+        b ^= seed;
+        multiply(a, b);
+        return mix(a ^ P0 ^ size, b ^ P1);
+    }
+
+    inline uint64_t hash(const char* str, size_t size, uint64_t seed = 0) {
+        return hash_with<plain_reader>(str, size, seed);
+    }
+
+    // hash folded to the 32 bits strings can cache
+    inline uint32_t hash32(const char* str, size_t size) {
+        auto res = hash(str, size);
+        return (uint32_t)(res ^ (res >> 32));
+    }
+}
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "string_hash.h"
+#include "string_kernels.h"
+
+// Interned strings: every distinct string gets a 32-bit symbol once,
+// equal strings always get the same symbol, so symbols compare as integers.
+// The table keeps chars in append-only chunks and entries in segments doubling
+// in size, nothing ever moves, so a symbol gives its chars without locking.
+// Strings are mapped to symbols by an open addressing index under a mutex,
+// a direct-mapped cache per thread answers repeated strings without it.
+// Strings are hashed by their hash() member, sso3 and sso4 return the cached value.
+namespace interning {
+
+    class symbol {
+        uint32_t _id;
+
+    public:
+        // the empty string
+        symbol() noexcept : _id(0) {}
+
+        explicit symbol(uint32_t id) noexcept : _id(id) {}
+
+        uint32_t id() const noexcept {
+            return _id;
+        }
+
+        friend bool operator==(symbol lhs, symbol rhs) noexcept {
+            return lhs._id == rhs._id;
+        }
+        friend bool operator!=(symbol lhs, symbol rhs) noexcept {
+            return lhs._id != rhs._id;
+        }
+        // order of interning, not of chars
+        friend bool operator<(symbol lhs, symbol rhs) noexcept {
+            return lhs._id < rhs._id;
+        }
+    };
+
+    // chars to intern with their hashing::hash32 value
+    struct key {
+        const char* data;
+        size_t size;
+        uint32_t hash;
+    };
+
+    inline key make_key(const char* str, size_t size) {
+        return key{ str, size, hashing::hash32(str, size) };
+    }
+
+    template <class String>
+    inline key make_key(const String& str) {
+        return key{ str.c_str(), str.size(), (uint32_t)str.hash() };
+    }
+
+    class table {
+        struct entry {
+            const char* data;
+            size_t size;
+            uint32_t hash;
+        };
+
+        enum {
+            FIRST_SEGMENT_BITS = 10,
+            SEGMENTS = 33 - FIRST_SEGMENT_BITS,
+            CHUNK_SIZE = 64 * 1024,
+            MIN_INDEX_SIZE = 64
+        };
+
+        // segment s keeps ids from (2^s - 1) * 2^FIRST_SEGMENT_BITS
+        static unsigned segment_of(uint32_t id) noexcept {
+            return kernels::highest_bit((id >> FIRST_SEGMENT_BITS) + 1);
+        }
+
+        static size_t segment_start(unsigned segment) noexcept {
+            return (((size_t)1 << segment) - 1) << FIRST_SEGMENT_BITS;
+        }
+
+        std::atomic<entry*> _segments[SEGMENTS];
+        std::atomic<uint32_t> _count;
+
+        // below are guarded by _mutex
+        std::mutex _mutex;
+        std::vector<uint64_t> _index;       // hash << 32 | (id + 1), 0 is free
+        std::vector<std::unique_ptr<char[]>> _chunks;
+        char* _chunk_pos;
+        size_t _chunk_left;
+        size_t _chars_size;
+
+        const entry& at(uint32_t id) const noexcept {
+            assert(id < _count.load(std::memory_order_relaxed));
+            auto segment = segment_of(id);
+            return _segments[segment].load(std::memory_order_acquire)[id - segment_start(segment)];
+        }
+
+        const char* store_chars(const char* str, size_t size) {
+            if (size + 1 > _chunk_left) {
+                // long strings get own chunks, the current one is kept for short ones
+                auto chunk_size = size + 1 > CHUNK_SIZE / 4 ? size + 1 : (size_t)CHUNK_SIZE;
+                _chunks.emplace_back(new char[chunk_size]);
+                _chars_size += chunk_size;
+                if (chunk_size == CHUNK_SIZE) {
+                    _chunk_pos = _chunks.back().get();
+                    _chunk_left = chunk_size;
+                }
+                else {
+                    std::memcpy(_chunks.back().get(), str, size);
+                    _chunks.back()[size] = 0;
+                    return _chunks.back().get();
+                }
+            }
+            auto res = _chunk_pos;
+            std::memcpy(res, str, size);
+            res[size] = 0;
+            _chunk_pos += size + 1;
+            _chunk_left -= size + 1;
+            return res;
+        }
+
+        void insert_index(uint64_t slot) noexcept {
+            const auto mask = _index.size() - 1;
+            auto i = (size_t)(slot >> 32) & mask;
+            while (_index[i] != 0) {
+                i = (i + 1) & mask;
+            }
+            _index[i] = slot;
+        }
+
+        void grow_index() {
+            std::vector<uint64_t> old(_index.size() * 2, 0);
+            old.swap(_index);
+            for (auto slot : old) {
+                if (slot != 0) insert_index(slot);
+            }
+        }
+
+        // _mutex is locked
+        symbol find_or_add(const key& str) {
+            const auto mask = _index.size() - 1;
+            auto i = (size_t)str.hash & mask;
+            for (; _index[i] != 0; i = (i + 1) & mask) {
+                auto slot = _index[i];
+                if ((uint32_t)(slot >> 32) != str.hash) continue;
+                auto id = (uint32_t)slot - 1;
+                auto& e = at(id);
+                if (e.size == str.size && kernels::equal(e.data, str.data, str.size)) {
+                    return symbol(id);
+                }
+            }
+
+            const auto id = _count.load(std::memory_order_relaxed);
+            assert(id < UINT32_MAX);
+            auto segment = segment_of(id);
+            auto entries = _segments[segment].load(std::memory_order_relaxed);
+            if (!entries) {
+                entries = new entry[(size_t)1 << (segment + FIRST_SEGMENT_BITS)];
+                _segments[segment].store(entries, std::memory_order_release);
+            }
+            entries[id - segment_start(segment)] = entry{ store_chars(str.data, str.size), str.size, str.hash };
+            _count.store(id + 1, std::memory_order_release);
+
+            _index[i] = ((uint64_t)str.hash << 32) | (id + 1);
+            if (2 * (size_t)(id + 1) > _index.size()) {
+                grow_index();
+            }
+            return symbol(id);
+        }
+
+    public:
+        table() : _count(0), _index(MIN_INDEX_SIZE, 0), _chunk_pos(nullptr), _chunk_left(0), _chars_size(0) {
+            for (auto& segment : _segments) {
+                segment.store(nullptr, std::memory_order_relaxed);
+            }
+            // symbol() is the empty string
+            find_or_add(make_key("", 0));
+        }
+
+        table(const table&) = delete;
+        table& operator=(const table&) = delete;
+
+        ~table() {
+            for (auto& segment : _segments) {
+                delete[] segment.load(std::memory_order_relaxed);
+            }
+        }
+
+        symbol intern(const key& str) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return find_or_add(str);
+        }
+
+        // all keys under one lock
+        void intern(const key* keys, size_t count, symbol* res) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (size_t i = 0; i < count; ++i) {
+                res[i] = find_or_add(keys[i]);
+            }
+        }
+
+        // the chars live as long as the table
+        const char* c_str(symbol str) const noexcept {
+            return at(str.id()).data;
+        }
+
+        size_t size(symbol str) const noexcept {
+            return at(str.id()).size;
+        }
+
+        uint32_t hash(symbol str) const noexcept {
+            return at(str.id()).hash;
+        }
+
+        // number of distinct strings, the empty one included
+        size_t symbol_count() const noexcept {
+            return _count.load(std::memory_order_acquire);
+        }
+
+        // bytes of chars, entries and index
+        size_t memory_usage() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            size_t res = _chars_size + _index.size() * sizeof(uint64_t);
+            auto count = _count.load(std::memory_order_relaxed);
+            for (unsigned segment = 0; segment <= segment_of(count - 1); ++segment) {
+                res += ((size_t)1 << (segment + FIRST_SEGMENT_BITS)) * sizeof(entry);
+            }
+            return res;
+        }
+    };
+
+    // front of a table used by one thread, remembers a symbol per hash slot
+    class cache {
+        enum { SLOTS = 1024 };
+
+        table& _table;
+        uint64_t _slots[SLOTS];     // hash << 32 | (id + 1), 0 is free
+        size_t _hits;
+        size_t _misses;
+
+        bool find(const key& str, symbol& res) const noexcept {
+            auto slot = _slots[str.hash & (SLOTS - 1)];
+            if (slot == 0 || (uint32_t)(slot >> 32) != str.hash) return false;
+            symbol candidate((uint32_t)slot - 1);
+            if (_table.size(candidate) != str.size || !kernels::equal(_table.c_str(candidate), str.data, str.size)) {
+                return false;
+            }
+            res = candidate;
+            return true;
+        }
+
+        void remember(const key& str, symbol res) noexcept {
+            _slots[str.hash & (SLOTS - 1)] = ((uint64_t)str.hash << 32) | (res.id() + 1);
+        }
+
+    public:
+        explicit cache(table& owner) : _table(owner), _slots(), _hits(0), _misses(0) {}
+
+        cache(const cache&) = delete;
+        cache& operator=(const cache&) = delete;
+
+        symbol intern(const key& str) {
+            symbol res;
+            if (find(str, res)) {
+                ++_hits;
+                return res;
+            }
+            ++_misses;
+            res = _table.intern(str);
+            remember(str, res);
+            return res;
+        }
+
+        // cached keys are answered here, the rest go to the table under one lock
+        void intern(const key* keys, size_t count, symbol* res) {
+            std::vector<key> missed;
+            std::vector<size_t> positions;
+            for (size_t i = 0; i < count; ++i) {
+                if (find(keys[i], res[i])) continue;
+                missed.push_back(keys[i]);
+                positions.push_back(i);
+            }
+            _hits += count - missed.size();
+            _misses += missed.size();
+            if (missed.empty()) return;
+            std::vector<symbol> found(missed.size());
+            _table.intern(missed.data(), missed.size(), found.data());
+            for (size_t i = 0; i < missed.size(); ++i) {
+                res[positions[i]] = found[i];
+                remember(missed[i], found[i]);
+            }
+        }
+
+        size_t hits() const noexcept {
+            return _hits;
+        }
+
+        size_t misses() const noexcept {
+            return _misses;
+        }
+    };
+
+    inline table& global_table() {
+        static table res;
+        return res;
+    }
+
+    inline cache& thread_cache() {
+        thread_local cache res(global_table());
+        return res;
+    }
+
+    inline symbol intern(const char* str, size_t size) {
+        return thread_cache().intern(make_key(str, size));
+    }
+
+    // any string class with c_str(), size() and hash()
+    template <class String>
+    inline symbol intern(const String& str) {
+        return thread_cache().intern(make_key(str));
+    }
+
+    // strings is a range of strings with c_str(), size() and hash()
+    template <class Strings>
+    inline std::vector<symbol> intern_all(const Strings& strings) {
+        std::vector<key> keys;
+        for (auto& str : strings) {
+            keys.push_back(make_key(str));
+        }
+        std::vector<symbol> res(keys.size());
+        thread_cache().intern(keys.data(), keys.size(), res.data());
+        return res;
+    }
+
+    inline const char* c_str(symbol str) noexcept {
+        return global_table().c_str(str);
+    }
+
+    inline size_t size(symbol str) noexcept {
+        return global_table().size(str);
+    }
+}
+
+namespace std {
+    template <>
+    struct hash<interning::symbol> {
+        size_t operator()(interning::symbol str) const noexcept {
+            return str.id();
+        }
+    };
+}
@@ -0,0 +1,384 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAS_SSE2 1
+#include <emmintrin.h>
+#else
+#define HAS_SSE2 0
+#endif
+
+#if defined(__AVX2__)
+#define HAS_AVX2 1
+#include <immintrin.h>
+#else
+#define HAS_AVX2 0
+#endif
+
+// AVX2 kernels are compiled into every x86 build and used only if CPU supports them
+#if HAS_SSE2 && (defined(_MSC_VER) || defined(__GNUC__))
+#define HAS_AVX2_DISPATCH 1
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__AVX2__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+#else
+#define HAS_AVX2_DISPATCH 0
+#endif
+
+// Copy and fill for the short edits strings do all the time.
+// Any size up to 64 is handled by two (or four) overlapping unaligned
+// loads and stores of the biggest fitting width, without loops or calls.
+// All loads are done before the first store, so move_small is safe for
+// overlapping ranges. Bigger sizes go to the C library.
+// Equality and three-way comparison of short ranges work the same way,
+// compare loads bytes in big endian order, so the first different byte decides.
+// Vector width is chosen at compile time (/arch:AVX2 or -mavx2 enables 32-byte
+// registers), a runtime dispatch would cost more than a 64-byte copy.
+namespace kernels {
+
+    enum { SMALL_SIZE = 64 };
+
+    inline uint64_t load8(const char* src) {
+        uint64_t res;
+        std::memcpy(&res, src, 8);
+        return res;
+    }
+    inline void store8(char* dst, uint64_t value) {
+        std::memcpy(dst, &value, 8);
+    }
+    inline uint32_t load4(const char* src) {
+        uint32_t res;
+        std::memcpy(&res, src, 4);
+        return res;
+    }
+    inline void store4(char* dst, uint32_t value) {
+        std::memcpy(dst, &value, 4);
+    }
+
+    // index of the lowest set bit
+    inline unsigned count_trailing_zeros(unsigned mask) {
+        assert(mask != 0);
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    inline unsigned count_trailing_zeros64(uint64_t mask) {
+        assert(mask != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return index;
+#elif defined(_MSC_VER)
+        return (uint32_t)mask ? count_trailing_zeros((uint32_t)mask) : 32 + count_trailing_zeros((uint32_t)(mask >> 32));
+#else
+        return __builtin_ctzll(mask);
+#endif
+    }
+
+    // index of the highest set bit
+    inline unsigned highest_bit(unsigned mask) {
+        assert(mask != 0);
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse(&index, mask);
+        return index;
+#else
+        return 31 - __builtin_clz(mask);
+#endif
+    }
+
+    inline unsigned highest_bit64(uint64_t mask) {
+        assert(mask != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanReverse64(&index, mask);
+        return index;
+#elif defined(_MSC_VER)
+        return mask >> 32 ? 32 + highest_bit((uint32_t)(mask >> 32)) : highest_bit((uint32_t)mask);
+#else
+        return 63 - __builtin_clzll(mask);
+#endif
+    }
+
+#if HAS_AVX2_DISPATCH
+    // checked once by kernels that have an AVX2 version
+    inline bool cpu_has_avx2() {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        const int osxsave_and_avx = (1 << 27) | (1 << 28);
+        if ((info[2] & osxsave_and_avx) != osxsave_and_avx) return false;
+        // OS saves xmm and ymm registers
+        if ((_xgetbv(0) & 6) != 6) return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    inline uint64_t load8_big_endian(const char* src) {
+#ifdef _MSC_VER
+        return _byteswap_uint64(load8(src));
+#else
+        return __builtin_bswap64(load8(src));
+#endif
+    }
+    inline uint32_t load4_big_endian(const char* src) {
+#ifdef _MSC_VER
+        return _byteswap_ulong(load4(src));
+#else
+        return __builtin_bswap32(load4(src));
+#endif
+    }
+
+    inline void move_small(char* dst, const char* src, size_t count) {
+        if (count >= 32) {
+#if HAS_AVX2
+            auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+            auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + count - 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), a);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + count - 32), b);
+#elif HAS_SSE2
+            auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+            auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + count - 32));
+            auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + count - 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), a);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + count - 32), c);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + count - 16), d);
+#else
+            char tmp[SMALL_SIZE];
+            std::memcpy(tmp, src, count);
+            std::memcpy(dst, tmp, count);
+#endif
+        }
+        else if (count >= 16) {
+#if HAS_SSE2
+            auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + count - 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), a);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + count - 16), b);
+#else
+            auto a = load8(src);
+            auto b = load8(src + 8);
+            auto c = load8(src + count - 16);
+            auto d = load8(src + count - 8);
+            store8(dst, a);
+            store8(dst + 8, b);
+            store8(dst + count - 16, c);
+            store8(dst + count - 8, d);
+#endif
+        }
+        else if (count >= 8) {
+            auto a = load8(src);
+            auto b = load8(src + count - 8);
+            store8(dst, a);
+            store8(dst + count - 8, b);
+        }
+        else if (count >= 4) {
+            auto a = load4(src);
+            auto b = load4(src + count - 4);
+            store4(dst, a);
+            store4(dst + count - 4, b);
+        }
+        else if (count > 0) {
+            // 1, 2 or 3 chars
+            auto a = src[0];
+            auto b = src[count / 2];
+            auto c = src[count - 1];
+            dst[0] = a;
+            dst[count / 2] = b;
+            dst[count - 1] = c;
+        }
+    }
+
+    inline void fill_small(char* dst, char ch, size_t count) {
+        if (count >= 16) {
+#if HAS_AVX2
+            if (count >= 32) {
+                auto value = _mm256_set1_epi8(ch);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), value);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + count - 32), value);
+                return;
+            }
+#endif
+#if HAS_SSE2
+            auto value = _mm_set1_epi8(ch);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + count - 16), value);
+            if (count > 32) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), value);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + count - 32), value);
+            }
+#else
+            std::memset(dst, ch, count);
+#endif
+        }
+        else if (count >= 8) {
+            auto value = (uint64_t)(unsigned char)ch * 0x0101010101010101ull;
+            store8(dst, value);
+            store8(dst + count - 8, value);
+        }
+        else if (count >= 4) {
+            auto value = (uint32_t)(unsigned char)ch * 0x01010101u;
+            store4(dst, value);
+            store4(dst + count - 4, value);
+        }
+        else if (count > 0) {
+            dst[0] = ch;
+            dst[count / 2] = ch;
+            dst[count - 1] = ch;
+        }
+    }
+
+    // memset into inline buffers of the string classes, count is below 32,
+    // so the compiler sees no stores past them
+    inline void fill_inline(char* dst, char ch, size_t count) {
+        assert(count < 32);
+        if (count >= 16) {
+#if HAS_SSE2
+            auto value = _mm_set1_epi8(ch);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + count - 16), value);
+#else
+            std::memset(dst, ch, count);
+#endif
+        }
+        else {
+            fill_small(dst, ch, count);
+        }
+    }
+
+    // memmove
+    inline void move(char* dst, const char* src, size_t count) {
+        if (count <= SMALL_SIZE) {
+            move_small(dst, src, count);
+        }
+        else {
+            std::memmove(dst, src, count);
+        }
+    }
+
+    // memcpy
+    inline void copy(char* dst, const char* src, size_t count) {
+        if (count <= SMALL_SIZE) {
+            move_small(dst, src, count);
+        }
+        else {
+            std::memcpy(dst, src, count);
+        }
+    }
+
+    // memset
+    inline void fill(char* dst, char ch, size_t count) {
+        if (count <= SMALL_SIZE) {
+            fill_small(dst, ch, count);
+        }
+        else {
+            std::memset(dst, ch, count);
+        }
+    }
+
+    // memcmp(a, b, count) == 0
+    inline bool equal(const char* a, const char* b, size_t count) {
+        if (count > SMALL_SIZE) {
+            return std::memcmp(a, b, count) == 0;
+        }
+        if (count >= 16) {
+#if HAS_SSE2
+            // full blocks and the last one, that may overlap the previous block
+            for (size_t i = 0; i + 16 < count; i += 16) {
+                auto eq = _mm_cmpeq_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+                if (_mm_movemask_epi8(eq) != 0xFFFF) return false;
+            }
+            auto eq = _mm_cmpeq_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + count - 16)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + count - 16)));
+            return _mm_movemask_epi8(eq) == 0xFFFF;
+#else
+            return std::memcmp(a, b, count) == 0;
+#endif
+        }
+        if (count >= 8) {
+            return ((load8(a) ^ load8(b)) | (load8(a + count - 8) ^ load8(b + count - 8))) == 0;
+        }
+        if (count >= 4) {
+            return ((load4(a) ^ load4(b)) | (load4(a + count - 4) ^ load4(b + count - 4))) == 0;
+        }
+        if (count > 0) {
+            return a[0] == b[0] && a[count / 2] == b[count / 2] && a[count - 1] == b[count - 1];
+        }
+        return true;
+    }
+
+    // memcmp, the sign of the result is the sign of the first different unsigned char difference
+    inline int compare(const char* a, const char* b, size_t count) {
+        if (count > SMALL_SIZE) {
+            return std::memcmp(a, b, count);
+        }
+        if (count >= 16) {
+#if HAS_SSE2
+            for (size_t i = 0; i < count; i += 16) {
+                // the last block overlaps the previous one, already equal chars do not matter
+                auto offset = i + 16 <= count ? i : count - 16;
+                auto eq = _mm_cmpeq_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + offset)),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + offset)));
+                unsigned mask = _mm_movemask_epi8(eq) ^ 0xFFFF;
+                if (mask) {
+                    auto index = offset + count_trailing_zeros(mask);
+                    return (unsigned char)a[index] - (unsigned char)b[index];
+                }
+            }
+            return 0;
+#else
+            return std::memcmp(a, b, count);
+#endif
+        }
+        if (count >= 8) {
+            auto x = load8_big_endian(a);
+            auto y = load8_big_endian(b);
+            if (x == y) {
+                x = load8_big_endian(a + count - 8);
+                y = load8_big_endian(b + count - 8);
+            }
+            return x < y ? -1 : x > y;
+        }
+        if (count >= 4) {
+            auto x = load4_big_endian(a);
+            auto y = load4_big_endian(b);
+            if (x == y) {
+                x = load4_big_endian(a + count - 4);
+                y = load4_big_endian(b + count - 4);
+            }
+            return x < y ? -1 : x > y;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (a[i] != b[i]) return (unsigned char)a[i] - (unsigned char)b[i];
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+// Perfect hash tables of fixed keyword sets built at compile time.
+// Keys are split into buckets by the high half of their 64-bit hash,
+// every bucket gets a displacement found so that hash ^ displacement of
+// its keys lands in free slots, biggest buckets first (hash and displace).
+// A lookup is one hash, one probe and one compare, misses included.
+// Duplicate keys are an error, distinct keys with equal hashes are
+// separated by hashing again with another seed.
+// Everything is constexpr, so tables are built by the compiler:
+//     constexpr keywords::key METHODS[] = { "GET", "HEAD", "POST" };
+//     constexpr keywords::table<3> methods(METHODS);
+//     methods.find(str, size) == 2 for "POST"
+namespace keywords {
+
+    const size_t npos = (size_t)-1;
+
+    struct key {
+        const char* data;
+        size_t size;
+
+        constexpr key() noexcept : data(""), size(0) {}
+
+        constexpr key(const char* str, size_t size) noexcept : data(str), size(size) {}
+
+        template <size_t N>
+        constexpr key(const char(&str)[N]) noexcept : data(str), size(N - 1) {}
+    };
+
+    // FNV-1a, constexpr and good enough for short keys, the seed changes the start value
+    constexpr uint64_t hash(const char* str, size_t size, uint64_t seed = 0) noexcept {
+        uint64_t res = 0xcbf29ce484222325ull + seed * 0x9E3779B97F4A7C15ull;
+        for (size_t i = 0; i < size; ++i) {
+            res = (res ^ (unsigned char)str[i]) * 0x100000001b3ull;
+        }
+        return res;
+    }
+
+    struct fnv1a {
+        static constexpr uint64_t hash(const char* str, size_t size, uint64_t seed) noexcept {
+            return keywords::hash(str, size, seed);
+        }
+    };
+
+    constexpr bool equal(const char* a, const char* b, size_t size) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            if (a[i] != b[i]) return false;
+        }
+        return true;
+    }
+
+    constexpr size_t slot_bits(size_t keys) noexcept {
+        // at least twice as many slots as keys
+        size_t res = 1;
+        while (((size_t)1 << res) < 2 * keys) ++res;
+        return res;
+    }
+
+    // Hash::hash(str, size, seed) is constexpr
+    template <size_t N, class Hash = fnv1a>
+    class table {
+        static_assert(N > 0, "keywords::table needs keys");
+
+        // small enough for the constexpr step limits of compilers
+        enum : size_t {
+            BUCKETS = N / 2 + 1,
+            SLOT_BITS = slot_bits(N),
+            SLOTS = (size_t)1 << SLOT_BITS,
+            MAX_DISPLACEMENT = 1 << 12,
+            MAX_SEEDS = 8
+        };
+
+        key _keys[N];
+        uint64_t _seed;
+        uint32_t _displacements[BUCKETS];
+        uint32_t _slots[SLOTS];     // key index + 1, 0 is free
+
+        static constexpr size_t bucket_of(uint64_t hash) noexcept {
+            return (size_t)((hash >> 32) % BUCKETS);
+        }
+
+        static constexpr size_t slot_of(uint64_t hash, uint32_t displacement) noexcept {
+            return (size_t)(((hash ^ displacement) * 0x9E3779B97F4A7C15ull) >> (64 - SLOT_BITS));
+        }
+
+        // false if the keys can't be placed with this seed, throws on duplicates
+        constexpr bool place(uint64_t seed) {
+            for (auto& slot : _slots) slot = 0;
+            for (auto& displacement : _displacements) displacement = 0;
+            uint64_t hashes[N] = {};
+            size_t bucket_sizes[BUCKETS] = {};
+            size_t max_bucket_size = 0;
+            for (size_t i = 0; i < N; ++i) {
+                hashes[i] = Hash::hash(_keys[i].data, _keys[i].size, seed);
+                auto size = ++bucket_sizes[bucket_of(hashes[i])];
+                if (size > max_bucket_size) max_bucket_size = size;
+            }
+
+            // keys sorted by bucket
+            size_t bucket_starts[BUCKETS + 1] = {};
+            for (size_t b = 0; b < BUCKETS; ++b) {
+                bucket_starts[b + 1] = bucket_starts[b] + bucket_sizes[b];
+            }
+            size_t order[N] = {};
+            size_t filled[BUCKETS] = {};
+            for (size_t i = 0; i < N; ++i) {
+                auto b = bucket_of(hashes[i]);
+                order[bucket_starts[b] + filled[b]++] = i;
+            }
+
+            // equal keys have equal hashes and share a bucket, other keys with
+            // equal hashes can't get distinct slots and need another seed
+            bool same_hashes = false;
+            for (size_t b = 0; b < BUCKETS; ++b) {
+                for (auto i = bucket_starts[b]; i < bucket_starts[b + 1]; ++i) {
+                    for (auto j = i + 1; j < bucket_starts[b + 1]; ++j) {
+                        if (hashes[order[i]] != hashes[order[j]]) continue;
+                        auto& a = _keys[order[i]];
+                        auto& other = _keys[order[j]];
+                        if (a.size == other.size && equal(a.data, other.data, a.size)) {
+                            throw std::logic_error("keywords::table: duplicate keys");
+                        }
+                        same_hashes = true;
+                    }
+                }
+            }
+            if (same_hashes) return false;
+
+            for (auto size = max_bucket_size; size > 0; --size) {
+                for (size_t b = 0; b < BUCKETS; ++b) {
+                    if (bucket_sizes[b] != size) continue;
+                    auto first = bucket_starts[b];
+                    uint32_t displacement = 0;
+                    for (;;) {
+                        // slots of the bucket's keys must be free and distinct
+                        size_t placed = 0;
+                        for (; placed < size; ++placed) {
+                            auto slot = slot_of(hashes[order[first + placed]], displacement);
+                            if (_slots[slot] != 0) break;
+                            _slots[slot] = (uint32_t)order[first + placed] + 1;
+                        }
+                        if (placed == size) break;
+                        for (size_t i = 0; i < placed; ++i) {
+                            _slots[slot_of(hashes[order[first + i]], displacement)] = 0;
+                        }
+                        if (++displacement == MAX_DISPLACEMENT) return false;
+                    }
+                    _displacements[b] = displacement;
+                }
+            }
+            return true;
+        }
+
+    public:
+        // keys must be distinct, duplicates stop the compilation
+        constexpr explicit table(const key(&keys)[N]) : _keys(), _seed(0), _displacements(), _slots() {
+            for (size_t i = 0; i < N; ++i) {
+                _keys[i] = keys[i];
+            }
+            for (uint64_t seed = 0; seed < MAX_SEEDS; ++seed) {
+                if (place(seed)) {
+                    _seed = seed;
+                    return;
+                }
+            }
+            throw std::logic_error("keywords::table: no perfect hash found");
+        }
+
+        // index of the key or npos
+        constexpr size_t find(const char* str, size_t size) const noexcept {
+            auto h = Hash::hash(str, size, _seed);
+            auto index = _slots[slot_of(h, _displacements[bucket_of(h)])];
+            if (index == 0) return npos;
+            auto& candidate = _keys[index - 1];
+            return candidate.size == size && equal(candidate.data, str, size) ? index - 1 : npos;
+        }
+
+        // any string class with c_str() and size()
+        template <class String>
+        size_t find(const String& str) const noexcept {
+            return find(str.c_str(), str.size());
+        }
+
+        constexpr bool contains(const char* str, size_t size) const noexcept {
+            return find(str, size) != npos;
+        }
+
+        constexpr size_t size() const noexcept {
+            return N;
+        }
+
+        constexpr const key& operator[](size_t index) const noexcept {
+            return _keys[index];
+        }
+    };
+
+    template <size_t N>
+    constexpr table<N> make_table(const key(&keys)[N]) {
+        return table<N>(keys);
+    }
+}
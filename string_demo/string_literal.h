@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+// Chars with static storage duration: string classes made from them
+// point to the chars until the first change instead of copying them,
+// and have nothing to free. "..."_static only accepts string literals,
+// static_chars can be filled by hand for other static zero-terminated chars.
+namespace literals {
+
+    struct static_chars {
+        const char* data;   // data[size] is zero
+        size_t size;
+    };
+
+    inline constexpr static_chars operator"" _static(const char* str, size_t size) noexcept {
+        return static_chars{ str, size };
+    }
+}
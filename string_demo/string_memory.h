@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// Heap buffers for the string classes.
+// Small buffers come from new[], growing them is allocate + copy + delete.
+// Large buffers are anonymous mappings on Linux and malloc blocks elsewhere,
+// growing them with mremap/realloc lets the kernel move pages instead of copying bytes.
+// Which kind of buffer is used depends only on capacity, so the owner
+// does not need to store anything else to free it.
+namespace memory {
+
+    const size_t BUFFER_PAGE_SIZE = 4096;
+    // buffers of this size (capacity + 1) and bigger are large
+    const size_t LARGE_BUFFER_SIZE = 16 * BUFFER_PAGE_SIZE;
+
+    inline bool is_large(size_t capacity) noexcept {
+        return capacity + 1 >= LARGE_BUFFER_SIZE;
+    }
+
+    // number of bytes really allocated for capacity chars and terminating zero
+    inline size_t buffer_size(size_t capacity) noexcept {
+        if (!is_large(capacity)) return capacity + 1;
+        return (capacity + BUFFER_PAGE_SIZE) & ~(BUFFER_PAGE_SIZE - 1);
+    }
+
+    // capacity that uses the whole buffer, large buffers are rounded up to pages
+    inline size_t round_capacity(size_t capacity) noexcept {
+        return buffer_size(capacity) - 1;
+    }
+
+    inline char* allocate_large(size_t bytes) {
+#ifdef __linux__
+        auto res = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (res == MAP_FAILED) {
+            throw std::bad_alloc{};
+        }
+#else
+        auto res = std::malloc(bytes);
+        if (!res) {
+            throw std::bad_alloc{};
+        }
+#endif
+        return static_cast<char*>(res);
+    }
+
+    inline void deallocate_large(char* data, size_t bytes) noexcept {
+#ifdef __linux__
+        ::munmap(data, bytes);
+#else
+        (void)bytes;
+        std::free(data);
+#endif
+    }
+
+    inline char* reallocate_large(char* data, size_t bytes, size_t new_bytes) {
+#ifdef __linux__
+        auto res = ::mremap(data, bytes, new_bytes, MREMAP_MAYMOVE);
+        if (res == MAP_FAILED) {
+            throw std::bad_alloc{};
+        }
+#else
+        (void)bytes;
+        auto res = std::realloc(data, new_bytes);
+        if (!res) {
+            throw std::bad_alloc{};
+        }
+#endif
+        return static_cast<char*>(res);
+    }
+
+    // buffer for capacity chars and terminating zero
+    inline char* allocate(size_t capacity) {
+        if (is_large(capacity)) {
+            return allocate_large(buffer_size(capacity));
+        }
+        return new char[capacity + 1];
+    }
+
+    inline void deallocate(char* data, size_t capacity) noexcept {
+        if (is_large(capacity)) {
+            deallocate_large(data, buffer_size(capacity));
+        }
+        else {
+            delete[] data;
+        }
+    }
+
+    // grows the buffer keeping the first size chars
+    inline char* reallocate(char* data, size_t size, size_t capacity, size_t new_capacity) {
+        assert(size <= capacity && capacity <= new_capacity);
+        if (is_large(capacity)) {
+            if (buffer_size(capacity) == buffer_size(new_capacity)) return data;
+            return reallocate_large(data, buffer_size(capacity), buffer_size(new_capacity));
+        }
+        auto new_data = allocate(new_capacity);
+        if (size > 0) {
+            std::memcpy(new_data, data, size);
+        }
+        delete[] data;
+        return new_data;
+    }
+}
@@ -0,0 +1,311 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "string_kernels.h"
+
+// Finds all occurrences of many patterns in one pass.
+// Aho-Corasick automaton is built for any set: a DFA over byte classes
+// (bytes used by patterns get own classes, all other bytes share class 0),
+// every state keeps the list of patterns ending there.
+// Small sets are scanned with Teddy filter if CPU has AVX2: patterns are split
+// into 8 buckets, for each of the first 3 chars of patterns two 16-entry tables
+// map low and high nibbles to bucket bits, shuffles of 32 text chars give
+// candidate start positions that are verified with memcmp.
+// Streams are scanned by the automaton, its state is kept between chunks.
+namespace multi_search {
+
+    struct match {
+        size_t pattern;     // index in the list matcher was built from
+        size_t position;    // start of the occurrence
+
+        bool operator==(const match& other) const {
+            return pattern == other.pattern && position == other.position;
+        }
+        bool operator<(const match& other) const {
+            return position < other.position || (position == other.position && pattern < other.pattern);
+        }
+    };
+
+    class matcher {
+    public:
+        enum {
+            TEDDY_MAX_PATTERNS = 32,
+            TEDDY_BUCKETS = 8,
+            TEDDY_MAX_FINGERPRINT = 3
+        };
+
+        // patterns is a range of strings with c_str() and size(), empty strings never match
+        template <class Strings>
+        explicit matcher(const Strings& patterns) {
+            for (auto& pattern : patterns) {
+                _offsets.push_back(_chars.size());
+                _chars.insert(_chars.end(), pattern.c_str(), pattern.c_str() + pattern.size());
+            }
+            _offsets.push_back(_chars.size());
+            build_automaton();
+            build_teddy();
+        }
+
+        size_t size() const noexcept {
+            return _offsets.size() - 1;
+        }
+
+        const char* pattern_data(size_t pattern) const noexcept {
+            return _chars.data() + _offsets[pattern];
+        }
+
+        size_t pattern_size(size_t pattern) const noexcept {
+            return _offsets[pattern + 1] - _offsets[pattern];
+        }
+
+        bool uses_teddy() const noexcept {
+            return _use_teddy;
+        }
+
+        // calls on_match(pattern, position) for every occurrence, the order is not specified
+        template <class OnMatch>
+        void scan(const char* str, size_t size, OnMatch&& on_match) const {
+#if HAS_AVX2_DISPATCH
+            if (_use_teddy) {
+                scan_teddy(str, size, on_match);
+                return;
+            }
+#endif
+            uint32_t state = 0;
+            scan_automaton(str, size, 0, state, on_match);
+        }
+
+        // all occurrences ordered by position and pattern
+        template <class String>
+        std::vector<match> find_all(const String& str) const {
+            std::vector<match> res;
+            scan(str.c_str(), str.size(), [&res](size_t pattern, size_t position) {
+                res.push_back(match{ pattern, position });
+            });
+            std::sort(res.begin(), res.end());
+            return res;
+        }
+
+        // text coming in chunks, occurrences may cross chunk borders,
+        // positions are counted from the start of the stream
+        class stream {
+            const matcher* _matcher;
+            uint32_t _state = 0;
+            size_t _offset = 0;
+
+        public:
+            explicit stream(const matcher& owner) noexcept : _matcher(&owner) {}
+
+            template <class OnMatch>
+            void feed(const char* str, size_t size, OnMatch&& on_match) {
+                _matcher->scan_automaton(str, size, _offset, _state, on_match);
+                _offset += size;
+            }
+
+            template <class String, class OnMatch>
+            void feed(const String& str, OnMatch&& on_match) {
+                feed(str.c_str(), str.size(), on_match);
+            }
+        };
+
+        stream make_stream() const noexcept {
+            return stream(*this);
+        }
+
+    private:
+        // patterns are stored one after another
+        std::vector<char> _chars;
+        std::vector<size_t> _offsets;
+
+        // automaton
+        uint16_t _byte_class[256];
+        uint32_t _classes = 1;
+        std::vector<uint32_t> _transitions;     // state * _classes + byte class
+        std::vector<uint32_t> _output_begin;    // patterns ending in state s are
+        std::vector<uint32_t> _outputs;         // _outputs[_output_begin[s]] .. _outputs[_output_begin[s + 1]]
+
+        // teddy
+        bool _use_teddy = false;
+        size_t _fingerprint = 0;
+        uint8_t _teddy_low[TEDDY_MAX_FINGERPRINT][16];
+        uint8_t _teddy_high[TEDDY_MAX_FINGERPRINT][16];
+        std::vector<uint32_t> _buckets[TEDDY_BUCKETS];
+
+        void build_automaton() {
+            std::memset(_byte_class, 0, sizeof(_byte_class));
+            for (auto ch : _chars) {
+                auto& cls = _byte_class[(unsigned char)ch];
+                if (cls == 0) cls = (uint16_t)_classes++;
+            }
+
+            // trie, missing transitions are NONE
+            const uint32_t NONE = (uint32_t)-1;
+            _transitions.assign(_classes, NONE);
+            std::vector<std::vector<uint32_t>> own_outputs(1);
+            for (size_t pattern = 0; pattern < size(); ++pattern) {
+                if (pattern_size(pattern) == 0) continue;
+                uint32_t state = 0;
+                auto data = pattern_data(pattern);
+                for (size_t i = 0; i < pattern_size(pattern); ++i) {
+                    auto& next = _transitions[state * _classes + _byte_class[(unsigned char)data[i]]];
+                    if (next == NONE) {
+                        next = (uint32_t)own_outputs.size();
+                        own_outputs.emplace_back();
+                        _transitions.resize(_transitions.size() + _classes, NONE);
+                    }
+                    state = _transitions[state * _classes + _byte_class[(unsigned char)data[i]]];
+                }
+                own_outputs[state].push_back((uint32_t)pattern);
+            }
+            auto states = own_outputs.size();
+
+            // breadth first: missing transitions follow failure links, outputs include outputs of failure states
+            std::vector<uint32_t> failure(states, 0);
+            std::vector<uint32_t> order;
+            order.reserve(states);
+            for (uint32_t cls = 0; cls < _classes; ++cls) {
+                auto& next = _transitions[cls];
+                if (next == NONE) {
+                    next = 0;
+                }
+                else {
+                    order.push_back(next);
+                }
+            }
+            for (size_t i = 0; i < order.size(); ++i) {
+                auto state = order[i];
+                for (uint32_t cls = 0; cls < _classes; ++cls) {
+                    auto& next = _transitions[state * _classes + cls];
+                    auto fallback = _transitions[failure[state] * _classes + cls];
+                    if (next == NONE) {
+                        next = fallback;
+                    }
+                    else {
+                        failure[next] = fallback;
+                        order.push_back(next);
+                    }
+                }
+            }
+
+            _output_begin.assign(states + 1, 0);
+            std::vector<std::vector<uint32_t>> outputs(states);
+            for (auto state : order) {
+                outputs[state] = own_outputs[state];
+                auto& inherited = outputs[failure[state]];
+                outputs[state].insert(outputs[state].end(), inherited.begin(), inherited.end());
+            }
+            for (size_t state = 0; state < states; ++state) {
+                _output_begin[state] = (uint32_t)_outputs.size();
+                _outputs.insert(_outputs.end(), outputs[state].begin(), outputs[state].end());
+            }
+            _output_begin[states] = (uint32_t)_outputs.size();
+        }
+
+        template <class OnMatch>
+        void scan_automaton(const char* str, size_t size, size_t offset, uint32_t& state, OnMatch& on_match) const {
+            auto transitions = _transitions.data();
+            auto classes = _classes;
+            auto current = state;
+            for (size_t i = 0; i < size; ++i) {
+                current = transitions[current * classes + _byte_class[(unsigned char)str[i]]];
+                for (auto k = _output_begin[current]; k < _output_begin[current + 1]; ++k) {
+                    auto pattern = _outputs[k];
+                    on_match((size_t)pattern, offset + i + 1 - pattern_size(pattern));
+                }
+            }
+            state = current;
+        }
+
+        void build_teddy() {
+            if (size() == 0 || size() > TEDDY_MAX_PATTERNS) return;
+            size_t min_size = (size_t)-1;
+            for (size_t pattern = 0; pattern < size(); ++pattern) {
+                min_size = std::min(min_size, pattern_size(pattern));
+            }
+            if (min_size == 0) return;
+#if HAS_AVX2_DISPATCH
+            _use_teddy = kernels::cpu_has_avx2();
+#endif
+            _fingerprint = std::min<size_t>(min_size, TEDDY_MAX_FINGERPRINT);
+
+            // patterns with common prefixes go to the same bucket
+            std::vector<uint32_t> sorted(size());
+            for (size_t pattern = 0; pattern < size(); ++pattern) {
+                sorted[pattern] = (uint32_t)pattern;
+            }
+            std::sort(sorted.begin(), sorted.end(), [this](uint32_t a, uint32_t b) {
+                return std::memcmp(pattern_data(a), pattern_data(b), _fingerprint) < 0;
+            });
+            auto per_bucket = (size() + TEDDY_BUCKETS - 1) / TEDDY_BUCKETS;
+            std::memset(_teddy_low, 0, sizeof(_teddy_low));
+            std::memset(_teddy_high, 0, sizeof(_teddy_high));
+            for (size_t i = 0; i < sorted.size(); ++i) {
+                auto bucket = i / per_bucket;
+                auto pattern = sorted[i];
+                _buckets[bucket].push_back(pattern);
+                for (size_t k = 0; k < _fingerprint; ++k) {
+                    auto ch = (unsigned char)pattern_data(pattern)[k];
+                    _teddy_low[k][ch & 0x0F] |= (uint8_t)(1 << bucket);
+                    _teddy_high[k][ch >> 4] |= (uint8_t)(1 << bucket);
+                }
+            }
+        }
+
+#if HAS_AVX2_DISPATCH
+        template <class OnMatch>
+        TARGET_AVX2 void scan_teddy(const char* str, size_t size, OnMatch& on_match) const {
+            const auto nibble = _mm256_set1_epi8(0x0F);
+            __m256i low[TEDDY_MAX_FINGERPRINT];
+            __m256i high[TEDDY_MAX_FINGERPRINT];
+            for (size_t k = 0; k < _fingerprint; ++k) {
+                low[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(_teddy_low[k])));
+                high[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(_teddy_high[k])));
+            }
+            char tail[64];
+            uint8_t buckets[32];
+            for (size_t i = 0; i < size; i += 32) {
+                auto block = str + i;
+                if (i + 32 + _fingerprint - 1 > size) {
+                    // zeros after the end may give candidates, they fail verification
+                    std::memset(tail, 0, sizeof(tail));
+                    std::memcpy(tail, str + i, size - i);
+                    block = tail;
+                }
+                auto candidates = _mm256_set1_epi8(-1);
+                for (size_t k = 0; k < _fingerprint; ++k) {
+                    auto input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + k));
+                    auto low_bits = _mm256_shuffle_epi8(low[k], _mm256_and_si256(input, nibble));
+                    auto high_bits = _mm256_shuffle_epi8(high[k], _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+                    candidates = _mm256_and_si256(candidates, _mm256_and_si256(low_bits, high_bits));
+                }
+                unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(candidates, _mm256_setzero_si256()));
+                if (mask == 0) continue;
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(buckets), candidates);
+                while (mask) {
+                    auto j = kernels::count_trailing_zeros(mask);
+                    mask &= mask - 1;
+                    verify(str, size, i + j, buckets[j], on_match);
+                }
+            }
+        }
+#endif
+
+        template <class OnMatch>
+        void verify(const char* str, size_t size, size_t position, unsigned bucket_bits, OnMatch& on_match) const {
+            while (bucket_bits) {
+                auto bucket = kernels::count_trailing_zeros(bucket_bits);
+                bucket_bits &= bucket_bits - 1;
+                for (auto pattern : _buckets[bucket]) {
+                    auto count = pattern_size(pattern);
+                    if (position + count <= size && std::memcmp(str + position, pattern_data(pattern), count) == 0) {
+                        on_match((size_t)pattern, position);
+                    }
+                }
+            }
+        }
+    };
+}
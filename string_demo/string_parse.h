@@ -0,0 +1,259 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "string_case.h"
+#include "string_hash.h"
+#include "string_kernels.h"
+#include "string_number_tables.h"
+
+// Chars to number conversion with error codes, the whole range must be the number,
+// no spaces, no leading '+', the value is kept on errors.
+// Runs of 8 digits are checked and converted as one 64-bit word (SWAR).
+// Doubles exact in one double operation are computed so (Clinger),
+// others with up to 19 significant digits by Eisel-Lemire algorithm:
+// the digits are multiplied by a 128-bit power of 5, the high bits give
+// the mantissa and the rounding direction. Longer numbers are truncated to 19 digits,
+// the rare ones that round differently after truncation go to strtod.
+namespace numbers {
+
+    enum parse_error {
+        PARSE_OK = 0,
+        PARSE_INVALID,          // not a number or not only a number
+        PARSE_OUT_OF_RANGE      // a number the type cannot hold
+    };
+
+    inline bool is_digit(char ch) {
+        return (unsigned char)(ch - '0') < 10;
+    }
+
+    // 8 chars in '0'..'9'
+    inline bool is_eight_digits(uint64_t word) {
+        return ((word & 0xF0F0F0F0F0F0F0F0ull) | (((word + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4))
+            == 0x3333333333333333ull;
+    }
+
+    // value of 8 digits, the first one is in the lowest byte
+    inline uint32_t parse_eight_digits(uint64_t word) {
+        word -= 0x3030303030303030ull;
+        // pairs of digits in even bytes, then pairs of pairs in the high half
+        word = word * 10 + (word >> 8);
+        word = (((word & 0x000000FF000000FFull) * (100 + (1000000ull << 32)))
+            + (((word >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+        return (uint32_t)word;
+    }
+
+    // appends digits starting at pos to value, returns the end of the digits
+    inline size_t parse_digit_run(const char* str, size_t size, size_t pos, uint64_t& value) {
+        for (; pos + 8 <= size; pos += 8) {
+            auto word = kernels::load8(str + pos);
+            if (!is_eight_digits(word)) break;
+            value = value * 100000000 + parse_eight_digits(word);
+        }
+        for (; pos < size && is_digit(str[pos]); ++pos) {
+            value = value * 10 + (unsigned)(str[pos] - '0');
+        }
+        return pos;
+    }
+
+    inline parse_error parse_digits(const char* str, size_t size, uint64_t limit, uint64_t& value) {
+        if (size == 0) return PARSE_INVALID;
+        size_t pos = 0;
+        while (pos < size && str[pos] == '0') ++pos;
+        const auto first = pos;
+        uint64_t res = 0;
+        if (parse_digit_run(str, size, pos, res) != size) return PARSE_INVALID;
+        // up to 19 digits never wrap, 20 digits starting with 1 wrap below 10^19
+        auto count = size - first;
+        if (count > 20 || (count == 20 && (str[first] > '1' || res < 10000000000000000000ull)) || res > limit) {
+            return PARSE_OUT_OF_RANGE;
+        }
+        value = res;
+        return PARSE_OK;
+    }
+
+    inline parse_error parse_uint(const char* str, size_t size, uint64_t& value) {
+        return parse_digits(str, size, std::numeric_limits<uint64_t>::max(), value);
+    }
+
+    inline parse_error parse_int(const char* str, size_t size, int64_t& value) {
+        const bool negative = size > 0 && str[0] == '-';
+        const uint64_t max = std::numeric_limits<int64_t>::max();
+        uint64_t magnitude;
+        auto res = parse_digits(str + negative, size - negative, max + negative, magnitude);
+        if (res == PARSE_OK) {
+            value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+        }
+        return res;
+    }
+
+    const uint64_t DOUBLE_INFINITY_BITS = 0x7FF0000000000000ull;
+
+    // bits of the double nearest to w * 10^q
+    inline uint64_t eisel_lemire(uint64_t w, int64_t q) {
+        const int MANTISSA_BITS = 52;
+        if (w == 0 || q < POW5_128_MIN) return 0;
+        if (q > POW5_128_MAX) return DOUBLE_INFINITY_BITS;
+
+        const int leading_zeros = 63 - (int)kernels::highest_bit64(w);
+        w <<= leading_zeros;
+        auto power = POW5_128[q - POW5_128_MIN];
+        uint64_t low = w, high = power[1];
+        hashing::multiply(low, high);
+        const uint64_t precision_mask = ~0ull >> (MANTISSA_BITS + 3);
+        if ((high & precision_mask) == precision_mask) {
+            // the lower half of the power may carry into the bits that matter
+            uint64_t low2 = w, high2 = power[0];
+            hashing::multiply(low2, high2);
+            low += high2;
+            if (high2 > low) ++high;
+        }
+
+        const int upper_bit = (int)(high >> 63);
+        const int shift = upper_bit + 64 - MANTISSA_BITS - 3;
+        uint64_t mantissa = high >> shift;
+        // floor(q * log2(10)) + 63 is the binary exponent of the power
+        int64_t power2 = (((152170 + 65536) * q) >> 16) + 63 + upper_bit - leading_zeros + 1023;
+        if (power2 <= 0) {
+            // subnormal, may become normal after rounding
+            if (-power2 + 1 >= 64) return 0;
+            mantissa >>= -power2 + 1;
+            mantissa += mantissa & 1;
+            mantissa >>= 1;
+            power2 = mantissa < (1ull << MANTISSA_BITS) ? 0 : 1;
+            return ((uint64_t)power2 << MANTISSA_BITS) | (mantissa & ((1ull << MANTISSA_BITS) - 1));
+        }
+        if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high) {
+            // exactly between two doubles, round to even
+            mantissa &= ~1ull;
+        }
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        if (mantissa >= (2ull << MANTISSA_BITS)) {
+            mantissa = 1ull << MANTISSA_BITS;
+            ++power2;
+        }
+        mantissa &= ~(1ull << MANTISSA_BITS);
+        if (power2 >= 0x7FF) return DOUBLE_INFINITY_BITS;
+        return ((uint64_t)power2 << MANTISSA_BITS) | mantissa;
+    }
+
+    const double EXACT_POWERS_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    // bits of the double nearest to w * 10^q
+    inline uint64_t decimal_to_double_bits(uint64_t w, int64_t q) {
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+        // w and 10^q are exact doubles, one rounding gives the right result
+        if (q >= -22 && q <= 22 && w <= (1ull << 53)) {
+            auto res = (double)w;
+            res = q < 0 ? res / EXACT_POWERS_OF_TEN[-q] : res * EXACT_POWERS_OF_TEN[q];
+            uint64_t bits;
+            std::memcpy(&bits, &res, sizeof(bits));
+            return bits;
+        }
+#endif
+        return eisel_lemire(w, q);
+    }
+
+    // [-]digits[.digits][e[+-]digits], inf, infinity or nan in any case
+    inline parse_error parse_double(const char* str, size_t size, double& value) {
+        size_t pos = 0;
+        const bool negative = size > 0 && str[0] == '-';
+        pos += negative;
+        if (pos < size && !is_digit(str[pos]) && str[pos] != '.') {
+            auto rest = str + pos;
+            auto count = size - pos;
+            double special;
+            if ((count == 3 || count == 8) && ascii::iequal(rest, "infinity", count)) {
+                special = std::numeric_limits<double>::infinity();
+            }
+            else if (count == 3 && ascii::iequal(rest, "nan", count)) {
+                special = std::numeric_limits<double>::quiet_NaN();
+            }
+            else {
+                return PARSE_INVALID;
+            }
+            value = negative ? -special : special;
+            return PARSE_OK;
+        }
+
+        const auto mantissa_begin = pos;
+        uint64_t w = 0;
+        pos = parse_digit_run(str, size, pos, w);
+        size_t digits = pos - mantissa_begin;
+        size_t fraction_digits = 0;
+        if (pos < size && str[pos] == '.') {
+            auto fraction_begin = ++pos;
+            pos = parse_digit_run(str, size, pos, w);
+            fraction_digits = pos - fraction_begin;
+            digits += fraction_digits;
+        }
+        if (digits == 0) return PARSE_INVALID;
+        const auto mantissa_end = pos;
+
+        int64_t exponent = 0;
+        if (pos < size && (str[pos] | 0x20) == 'e') {
+            ++pos;
+            const bool negative_exponent = pos < size && str[pos] == '-';
+            if (pos < size && (str[pos] == '-' || str[pos] == '+')) ++pos;
+            if (pos == size) return PARSE_INVALID;
+            for (; pos < size; ++pos) {
+                if (!is_digit(str[pos])) return PARSE_INVALID;
+                // anything larger is zero or infinity anyway
+                if (exponent < 0x10000000) {
+                    exponent = exponent * 10 + (str[pos] - '0');
+                }
+            }
+            if (negative_exponent) exponent = -exponent;
+        }
+        if (pos != size) return PARSE_INVALID;
+
+        uint64_t bits;
+        if (digits <= 19) {
+            bits = decimal_to_double_bits(w, exponent - (int64_t)fraction_digits);
+        }
+        else {
+            // w wrapped, take the first 19 significant digits
+            w = 0;
+            size_t used = 0;
+            bool in_fraction = false;
+            bool truncated = false;
+            for (auto i = mantissa_begin; i < mantissa_end; ++i) {
+                if (str[i] == '.') {
+                    in_fraction = true;
+                    continue;
+                }
+                auto digit = (unsigned)(str[i] - '0');
+                if (used < 19) {
+                    if (w != 0 || digit != 0) {
+                        w = w * 10 + digit;
+                        ++used;
+                    }
+                    exponent -= in_fraction;
+                }
+                else {
+                    exponent += !in_fraction;
+                    truncated |= digit != 0;
+                }
+            }
+            bits = decimal_to_double_bits(w, exponent);
+            if (truncated && bits != decimal_to_double_bits(w + 1, exponent)) {
+                // the dropped digits decide the rounding
+                auto res = std::strtod(std::string(str + negative, size - negative).c_str(), nullptr);
+                std::memcpy(&bits, &res, sizeof(bits));
+            }
+        }
+        if (bits == DOUBLE_INFINITY_BITS) return PARSE_OUT_OF_RANGE;
+        bits |= (uint64_t)negative << 63;
+        std::memcpy(&value, &bits, sizeof(value));
+        return PARSE_OK;
+    }
+}
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <cstring>
+#include <cassert>
+
+#include "string_kernels.h"
+
+// Search in (pointer, size) ranges, '\0' is an ordinary char here.
+// Every function has a scalar version, SSE2 and AVX2 kernels scan 16/32 positions at once.
+// Substrings are found with the first/last char filter: a position is compared
+// with memcmp only if both the first and the last chars of the pattern match there.
+// AVX2 or SSE2 kernels are chosen once by CPUID, ranges shorter than 16 chars
+// (all SSO strings) are searched by scalar code without the indirect call.
+namespace search {
+
+    const size_t npos = (size_t)-1;
+
+    using kernels::count_trailing_zeros;
+    using kernels::highest_bit;
+#if HAS_AVX2_DISPATCH
+    using kernels::cpu_has_avx2;
+#endif
+
+    // scalar versions
+
+    inline size_t find_char_scalar(const char* str, size_t size, char ch, size_t from) {
+        if (from >= size) return npos;
+        auto found = static_cast<const char*>(std::memchr(str + from, ch, size - from));
+        return found ? found - str : npos;
+    }
+
+    inline size_t rfind_char_scalar(const char* str, size_t size, char ch, size_t pos) {
+        for (auto i = pos < size ? pos + 1 : size; i > 0; --i) {
+            if (str[i - 1] == ch) return i - 1;
+        }
+        return npos;
+    }
+
+    inline size_t find_scalar(const char* str, size_t size, const char* pattern, size_t pattern_size, size_t from) {
+        if (pattern_size == 0) return from <= size ? from : npos;
+        while (from + pattern_size <= size) {
+            auto found = static_cast<const char*>(std::memchr(str + from, pattern[0], size - pattern_size + 1 - from));
+            if (!found) break;
+            from = found - str;
+            if (std::memcmp(found + 1, pattern + 1, pattern_size - 1) == 0) return from;
+            ++from;
+        }
+        return npos;
+    }
+
+    inline size_t rfind_scalar(const char* str, size_t size, const char* pattern, size_t pattern_size, size_t pos) {
+        if (pattern_size > size) return npos;
+        auto last = size - pattern_size;
+        for (auto i = (pos < last ? pos : last) + 1; i > 0; --i) {
+            if (std::memcmp(str + i - 1, pattern, pattern_size) == 0) return i - 1;
+        }
+        return npos;
+    }
+
+    // finds the first char that is (or with negate is not) one of chars
+    inline size_t find_first_of_scalar(const char* str, size_t size, const char* chars, size_t chars_size, size_t from, bool negate) {
+        bool table[256] = {};
+        for (size_t i = 0; i < chars_size; ++i) {
+            table[(unsigned char)chars[i]] = true;
+        }
+        for (; from < size; ++from) {
+            if (table[(unsigned char)str[from]] != negate) return from;
+        }
+        return npos;
+    }
+
+#if HAS_SSE2
+    inline size_t find_char_sse2(const char* str, size_t size, char ch, size_t from) {
+        const __m128i needle = _mm_set1_epi8(ch);
+        for (; from + 16 <= size; from += 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + from));
+            unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+            if (mask) return from + count_trailing_zeros(mask);
+        }
+        return find_char_scalar(str, size, ch, from);
+    }
+
+    inline size_t rfind_char_sse2(const char* str, size_t size, char ch, size_t pos) {
+        const __m128i needle = _mm_set1_epi8(ch);
+        auto end = pos < size ? pos + 1 : size;
+        for (; end >= 16; end -= 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + end - 16));
+            unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+            if (mask) return end - 16 + highest_bit(mask);
+        }
+        return end ? rfind_char_scalar(str, end, ch, end - 1) : npos;
+    }
+
+    inline size_t find_sse2(const char* str, size_t size, const char* pattern, size_t pattern_size, size_t from) {
+        assert(pattern_size > 1);
+        const __m128i first = _mm_set1_epi8(pattern[0]);
+        const __m128i last = _mm_set1_epi8(pattern[pattern_size - 1]);
+        for (; from + pattern_size - 1 + 16 <= size; from += 16) {
+            auto block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + from));
+            auto block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + from + pattern_size - 1));
+            auto eq = _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last));
+            unsigned mask = _mm_movemask_epi8(eq);
+            while (mask) {
+                auto pos = from + count_trailing_zeros(mask);
+                if (std::memcmp(str + pos + 1, pattern + 1, pattern_size - 2) == 0) return pos;
+                mask &= mask - 1;
+            }
+        }
+        return find_scalar(str, size, pattern, pattern_size, from);
+    }
+
+    inline size_t rfind_sse2(const char* str, size_t size, const char* pattern, size_t pattern_size, size_t pos) {
+        assert(pattern_size > 1);
+        if (pattern_size > size) return npos;
+        const __m128i first = _mm_set1_epi8(pattern[0]);
+        const __m128i last = _mm_set1_epi8(pattern[pattern_size - 1]);
+        // candidates are [0, end)
+        auto end = (pos < size - pattern_size ? pos : size - pattern_size) + 1;
+        for (; end >= 16; end -= 16) {
+            auto base = end - 16;
+            auto block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + base));
+            auto block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + base + pattern_size - 1));
+            auto eq = _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last));
+            unsigned mask = _mm_movemask_epi8(eq);
+            while (mask) {
+                auto bit = highest_bit(mask);
+                if (std::memcmp(str + base + bit + 1, pattern + 1, pattern_size - 2) == 0) return base + bit;
+                mask ^= 1u << bit;
+            }
+        }
+        return end ? rfind_scalar(str, size, pattern, pattern_size, end - 1) : npos;
+    }
+
+    inline size_t find_first_of_sse2(const char* str, size_t size, const char* chars, size_t chars_size, size_t from, bool negate) {
+        assert(chars_size <= 16);
+        __m128i needles[16];
+        for (size_t i = 0; i < chars_size; ++i) {
+            needles[i] = _mm_set1_epi8(chars[i]);
+        }
+        const unsigned invert = negate ? 0xFFFF : 0;
+        for (; from + 16 <= size; from += 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + from));
+            auto any = _mm_setzero_si128();
+            for (size_t i = 0; i < chars_size; ++i) {
+                any = _mm_or_si128(any, _mm_cmpeq_epi8(block, needles[i]));
+            }
+            unsigned mask = _mm_movemask_epi8(any) ^ invert;
+            if (mask) return from + count_trailing_zeros(mask);
+        }
+        return find_first_of_scalar(str, size, chars, chars_size, from, negate);
+    }
+#endif
+
+#if HAS_AVX2_DISPATCH
+    TARGET_AVX2 inline size_t find_char_avx2(const char* str, size_t size, char ch, size_t from) {
+        const __m256i needle = _mm256_set1_epi8(ch);
+        for (; from + 32 <= size; from += 32) {
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + from));
+            unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+            if (mask) return from + count_trailing_zeros(mask);
+        }
+        return find_char_sse2(str, size, ch, from);
+    }
+
+    TARGET_AVX2 inline size_t rfind_char_avx2(const char* str, size_t size, char ch, size_t pos) {
+        const __m256i needle = _mm256_set1_epi8(ch);
+        auto end = pos < size ? pos + 1 : size;
+        for (; end >= 32; end -= 32) {
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + end - 32));
+            unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+            if (mask) return end - 32 + highest_bit(mask);
+        }
+        return end ? rfind_char_sse2(str, end, ch, end - 1) : npos;
+    }
+
+    TARGET_AVX2 inline size_t find_avx2(const char* str, size_t size, const char* pattern, size_t pattern_size, size_t from) {
+        assert(pattern_size > 1);
+        const __m256i first = _mm256_set1_epi8(pattern[0]);
+        const __m256i last = _mm256_set1_epi8(pattern[pattern_size - 1]);
+        for (; from + pattern_size - 1 + 32 <= size; from += 32) {
+            auto block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + from));
+            auto block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + from + pattern_size - 1));
+            auto eq = _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last));
+            unsigned mask = _mm256_movemask_epi8(eq);
+            while (mask) {
+                auto pos = from + count_trailing_zeros(mask);
+                if (std::memcmp(str + pos + 1, pattern + 1, pattern_size - 2) == 0) return pos;
+                mask &= mask - 1;
+            }
+        }
+        return find_sse2(str, size, pattern, pattern_size, from);
+    }
+
+    TARGET_AVX2 inline size_t rfind_avx2(const char* str, size_t size, const char* pattern, size_t pattern_size, size_t pos) {
+        assert(pattern_size > 1);
+        if (pattern_size > size) return npos;
+        const __m256i first = _mm256_set1_epi8(pattern[0]);
+        const __m256i last = _mm256_set1_epi8(pattern[pattern_size - 1]);
+        auto end = (pos < size - pattern_size ? pos : size - pattern_size) + 1;
+        for (; end >= 32; end -= 32) {
+            auto base = end - 32;
+            auto block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + base));
+            auto block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + base + pattern_size - 1));
+            auto eq = _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last));
+            unsigned mask = _mm256_movemask_epi8(eq);
+            while (mask) {
+                auto bit = highest_bit(mask);
+                if (std::memcmp(str + base + bit + 1, pattern + 1, pattern_size - 2) == 0) return base + bit;
+                mask ^= 1u << bit;
+            }
+        }
+        return end ? rfind_sse2(str, size, pattern, pattern_size, end - 1) : npos;
+    }
+
+    TARGET_AVX2 inline size_t find_first_of_avx2(const char* str, size_t size, const char* chars, size_t chars_size, size_t from, bool negate) {
+        assert(chars_size <= 16);
+        __m256i needles[16];
+        for (size_t i = 0; i < chars_size; ++i) {
+            needles[i] = _mm256_set1_epi8(chars[i]);
+        }
+        const unsigned invert = negate ? 0xFFFFFFFF : 0;
+        for (; from + 32 <= size; from += 32) {
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + from));
+            auto any = _mm256_setzero_si256();
+            for (size_t i = 0; i < chars_size; ++i) {
+                any = _mm256_or_si256(any, _mm256_cmpeq_epi8(block, needles[i]));
+            }
+            unsigned mask = (unsigned)_mm256_movemask_epi8(any) ^ invert;
+            if (mask) return from + count_trailing_zeros(mask);
+        }
+        return find_first_of_sse2(str, size, chars, chars_size, from, negate);
+    }
+
+#endif
+
+    struct kernels_table {
+        size_t(*find_char)(const char*, size_t, char, size_t);
+        size_t(*rfind_char)(const char*, size_t, char, size_t);
+        size_t(*find)(const char*, size_t, const char*, size_t, size_t);
+        size_t(*rfind)(const char*, size_t, const char*, size_t, size_t);
+        size_t(*find_first_of)(const char*, size_t, const char*, size_t, size_t, bool);
+    };
+
+    inline kernels_table select_kernels() {
+#if HAS_AVX2_DISPATCH
+        if (cpu_has_avx2()) {
+            return { find_char_avx2, rfind_char_avx2, find_avx2, rfind_avx2, find_first_of_avx2 };
+        }
+#endif
+#if HAS_SSE2
+        return { find_char_sse2, rfind_char_sse2, find_sse2, rfind_sse2, find_first_of_sse2 };
+#else
+        return { find_char_scalar, rfind_char_scalar, find_scalar, rfind_scalar, find_first_of_scalar };
+#endif
+    }
+
+    inline const kernels_table& kernels() {
+        static const kernels_table table = select_kernels();
+        return table;
+    }
+
+    enum { MIN_VECTOR_SIZE = 16 };
+
+    // position of the first ch starting at from or npos
+    inline size_t find(const char* str, size_t size, char ch, size_t from = 0) {
+        if (from >= size) return npos;
+        if (size - from < MIN_VECTOR_SIZE) return find_char_scalar(str, size, ch, from);
+        return kernels().find_char(str, size, ch, from);
+    }
+
+    // position of the last ch at or before pos or npos
+    inline size_t rfind(const char* str, size_t size, char ch, size_t pos = npos) {
+        if (size < MIN_VECTOR_SIZE || pos < MIN_VECTOR_SIZE) return rfind_char_scalar(str, size, ch, pos);
+        return kernels().rfind_char(str, size, ch, pos);
+    }
+
+    // position of the first occurrence of pattern starting at from or npos
+    inline size_t find(const char* str, size_t size, const char* pattern, size_t pattern_size, size_t from = 0) {
+        if (pattern_size == 1) return find(str, size, pattern[0], from);
+        if (pattern_size == 0 || from > size || size - from < pattern_size - 1 + MIN_VECTOR_SIZE) {
+            return find_scalar(str, size, pattern, pattern_size, from);
+        }
+        return kernels().find(str, size, pattern, pattern_size, from);
+    }
+
+    // position of the last occurrence of pattern starting at or before pos or npos
+    inline size_t rfind(const char* str, size_t size, const char* pattern, size_t pattern_size, size_t pos = npos) {
+        if (pattern_size == 0) return pos < size ? pos : size;
+        if (pattern_size == 1) return rfind(str, size, pattern[0], pos);
+        if (size < pattern_size - 1 + MIN_VECTOR_SIZE || pos < MIN_VECTOR_SIZE) {
+            return rfind_scalar(str, size, pattern, pattern_size, pos);
+        }
+        return kernels().rfind(str, size, pattern, pattern_size, pos);
+    }
+
+    // position of the first char that is one of chars
+    inline size_t find_first_of(const char* str, size_t size, const char* chars, size_t chars_size, size_t from = 0) {
+        if (from >= size || chars_size == 0) return npos;
+        if (chars_size == 1) return find(str, size, chars[0], from);
+        if (size - from < MIN_VECTOR_SIZE || chars_size > 16) {
+            return find_first_of_scalar(str, size, chars, chars_size, from, false);
+        }
+        return kernels().find_first_of(str, size, chars, chars_size, from, false);
+    }
+
+    // position of the first char that is none of chars
+    inline size_t find_first_not_of(const char* str, size_t size, const char* chars, size_t chars_size, size_t from = 0) {
+        if (from >= size) return npos;
+        if (size - from < MIN_VECTOR_SIZE || chars_size > 16) {
+            return find_first_of_scalar(str, size, chars, chars_size, from, true);
+        }
+        return kernels().find_first_of(str, size, chars, chars_size, from, true);
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+
+#include "string_search.h"
+
+// Zero-copy splitting: tokens are (pointer, length) views into the string,
+// valid until the string is modified or destroyed.
+// Ranges are lazy, every step of an iterator finds the next separator
+// with the SIMD kernels of string_search.h, nothing is allocated.
+// Like Python str.split(sep) empty tokens are kept: "a,,b" gives "a", "", "b",
+// skip_empty() drops them to tokenize text with runs of separators.
+namespace splitting {
+
+    struct token {
+        const char* data;
+        size_t size;
+
+        bool operator==(const char* str) const noexcept {
+            return std::strlen(str) == size && std::memcmp(data, str, size) == 0;
+        }
+        bool operator!=(const char* str) const noexcept {
+            return !(*this == str);
+        }
+    };
+
+    struct char_delimiter {
+        char ch;
+
+        size_t find(const char* str, size_t size, size_t from) const noexcept {
+            return search::find(str, size, ch, from);
+        }
+        size_t size() const noexcept {
+            return 1;
+        }
+    };
+
+    // any of chars separates tokens, chars must outlive the range
+    struct any_of_delimiter {
+        const char* chars;
+        size_t count;
+
+        size_t find(const char* str, size_t size, size_t from) const noexcept {
+            return search::find_first_of(str, size, chars, count, from);
+        }
+        size_t size() const noexcept {
+            return 1;
+        }
+    };
+
+    // pattern must outlive the range, empty pattern never matches
+    struct substring_delimiter {
+        const char* pattern;
+        size_t count;
+
+        size_t find(const char* str, size_t size, size_t from) const noexcept {
+            return count == 0 ? search::npos : search::find(str, size, pattern, count, from);
+        }
+        size_t size() const noexcept {
+            return count;
+        }
+    };
+
+    template <class Delimiter>
+    class range {
+        const char* _data;
+        size_t _size;
+        Delimiter _delimiter;
+        bool _skip_empty;
+
+    public:
+        range(const char* data, size_t size, Delimiter delimiter, bool skip_empty = false) noexcept
+            : _data(data), _size(size), _delimiter(delimiter), _skip_empty(skip_empty) {}
+
+        // iterators keep a copy of the range, they stay valid after the range is gone
+        class iterator {
+            const char* _data;
+            size_t _size;
+            Delimiter _delimiter;
+            bool _skip_empty;
+            size_t _begin = search::npos;   // npos for the end iterator
+            size_t _end = search::npos;
+
+            void find_token(size_t from) noexcept {
+                for (;;) {
+                    auto pos = _delimiter.find(_data, _size, from);
+                    if (pos == search::npos) pos = _size;
+                    if (pos == from && _skip_empty) {
+                        if (pos == _size) {
+                            _begin = _end = search::npos;
+                            return;
+                        }
+                        from = pos + _delimiter.size();
+                        continue;
+                    }
+                    _begin = from;
+                    _end = pos;
+                    return;
+                }
+            }
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = token;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const token*;
+            using reference = token;
+
+            iterator(const range& owner, bool is_end) noexcept
+                : _data(owner._data), _size(owner._size), _delimiter(owner._delimiter), _skip_empty(owner._skip_empty) {
+                if (!is_end) find_token(0);
+            }
+
+            token operator*() const noexcept {
+                return token{ _data + _begin, _end - _begin };
+            }
+
+            iterator& operator++() noexcept {
+                if (_end == _size) {
+                    _begin = _end = search::npos;
+                }
+                else {
+                    find_token(_end + _delimiter.size());
+                }
+                return *this;
+            }
+            iterator operator++(int) noexcept {
+                auto res = *this;
+                ++*this;
+                return res;
+            }
+
+            bool operator==(const iterator& other) const noexcept {
+                return _begin == other._begin;
+            }
+            bool operator!=(const iterator& other) const noexcept {
+                return _begin != other._begin;
+            }
+        };
+
+        iterator begin() const noexcept {
+            return iterator(*this, false);
+        }
+        iterator end() const noexcept {
+            return iterator(*this, true);
+        }
+
+        range skip_empty() const noexcept {
+            return range(_data, _size, _delimiter, true);
+        }
+
+        size_t count() const noexcept {
+            size_t res = 0;
+            for (auto it = begin(), last = end(); it != last; ++it) ++res;
+            return res;
+        }
+    };
+
+    inline range<char_delimiter> by_char(const char* str, size_t size, char ch) noexcept {
+        return range<char_delimiter>(str, size, char_delimiter{ ch });
+    }
+
+    inline range<any_of_delimiter> by_any_of(const char* str, size_t size, const char* chars) noexcept {
+        return range<any_of_delimiter>(str, size, any_of_delimiter{ chars, std::strlen(chars) });
+    }
+
+    inline range<substring_delimiter> by_substring(const char* str, size_t size, const char* pattern) noexcept {
+        return range<substring_delimiter>(str, size, substring_delimiter{ pattern, std::strlen(pattern) });
+    }
+}
@@ -1,11 +1,39 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
+#include <unordered_set>
 
+#include "const_string.h"
 #include "string_api.h"
+#include "string_case.h"
+#include "string_dedup.h"
+#include "string_edit_distance.h"
+#include "string_epoch.h"
+#include "string_format.h"
+#include "string_hash.h"
+#include "string_intern.h"
+#include "string_kernels.h"
+#include "string_keywords.h"
+#include "string_literal.h"
+#include "string_multi_search.h"
+#include "string_parse.h"
+#include "string_search.h"
+#include "string_split.h"
+#include "string_utf8.h"
 #include "simple_string.h"
 #include "sso_string.h"
+#include "sso_string3.h"
+#include "sso_string4.h"
+#include "gap_string.h"
+#include "rope_string.h"
 
 #include "test_allocator.h"
 
@@ -303,6 +331,95 @@ TEST(string, move_constructor_allocations) {
     EXPECT_EQ(memory.active_used_memory(), 0u);
 }
 
+TEST(string, cow_copy_allocations) {
+    if (SKIP_ALLOCATIONS_TEST) return;
+
+    allocations_recorder memory;
+    size_t used_capacity;
+    {
+        sso4::cow_string short_string("short string");
+        sso4::cow_string long_string("loooooooooooooooooooooong string");
+
+        sso4::cow_string short_string_copy(short_string);
+        sso4::cow_string long_string_copy(long_string);
+        sso4::cow_string assigned;
+        assigned = long_string_copy;
+        EXPECT_EQ(long_string_copy.c_str(), long_string.c_str());
+        EXPECT_EQ(assigned.c_str(), long_string.c_str());
+
+        // the first change copies the chars, later ones use the own buffer
+        long_string_copy.replace(0, 1, "L");
+        long_string_copy.replace(1, 1, "O");
+        EXPECT_STREQ(long_string_copy.c_str(), "LOooooooooooooooooooooong string");
+        EXPECT_STREQ(long_string.c_str(), "loooooooooooooooooooooong string");
+        EXPECT_EQ(assigned.c_str(), long_string.c_str());
+
+        used_capacity = long_string.capacity();
+        EXPECT_EQ(long_string_copy.capacity(), used_capacity);
+    }
+    memory.stop();
+    // heap buffers start with the reference count
+    EXPECT_EQ(memory.total_allocations(), 2u);
+    EXPECT_EQ(memory.total_used_memory(), 2 * (used_capacity + 1 + sizeof(size_t)));
+    EXPECT_EQ(memory.active_allocations(), 0u);
+    EXPECT_EQ(memory.active_used_memory(), 0u);
+}
+
+TEST(string, cow_detach) {
+    const char* text = "a value copied into several containers";
+    const sso4::cow_string original(text);
+    auto check_detached = [&](sso4::cow_string changed, const char* expected, void (*change)(sso4::cow_string&)) {
+        EXPECT_EQ(changed.c_str(), original.c_str());
+        change(changed);
+        EXPECT_STREQ(changed.c_str(), expected);
+        EXPECT_NE(changed.c_str(), original.c_str());
+        EXPECT_STREQ(original.c_str(), text);
+    };
+    check_detached(original, "a value copied", [](sso4::cow_string& s) { s.erase(14, 100); });
+    check_detached(original, "a value copied", [](sso4::cow_string& s) { s.resize(14); });
+    check_detached(original, "a value copied into several containers!!", [](sso4::cow_string& s) { s.resize(s.size() + 2, '!'); });
+    check_detached(original, "A VALUE COPIED INTO SEVERAL CONTAINERS", [](sso4::cow_string& s) { s.to_upper(); });
+    check_detached(original, "a key copied into several containers", [](sso4::cow_string& s) { s.replace(2, 5, "key"); });
+    check_detached(original, "a_value_copied_into_several_containers", [](sso4::cow_string& s) { s.replace_all(" ", "_"); });
+    check_detached(original, "a value copied into several containers.", [](sso4::cow_string& s) { s.insert(s.size(), "."); });
+    check_detached(original, "a value copied into several containers containers", [](sso4::cow_string& s) { s.insert(s.size(), s.c_str() + 27); });
+    check_detached(original, "a value copied into several containers__", [](sso4::cow_string& s) { s.insert(s.size(), 2, '_'); });
+    check_detached(original, "b value copied into several containers", [](sso4::cow_string& s) { *s.begin() = 'b'; });
+    check_detached(original, "short", [](sso4::cow_string& s) { s = sso4::cow_string("short"); });
+
+    // reserving space is not a change
+    sso4::cow_string copy = original;
+    copy.reserve(original.capacity());
+    EXPECT_EQ(copy.c_str(), original.c_str());
+    copy.reserve(original.capacity() + 1);
+    EXPECT_NE(copy.c_str(), original.c_str());
+    EXPECT_EQ(copy, original);
+
+    // the last owner changes the buffer in place
+    sso4::cow_string unique = sso4::cow_string(text);
+    copy = unique;
+    copy = sso4::cow_string();
+    auto data = unique.c_str();
+    unique.to_upper();
+    EXPECT_EQ(unique.c_str(), data);
+
+    // copies made by other threads
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&original, text] {
+            for (int i = 0; i < 1000; ++i) {
+                sso4::cow_string copy = original;
+                if (i % 2) copy.to_upper();
+                EXPECT_EQ(copy.size(), original.size());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_STREQ(original.c_str(), text);
+}
+
 TEST(string, insert) {
     string str;
     str.insert(0, "");
@@ -323,6 +440,25 @@ TEST(string, insert) {
     EXPECT_LT(str.size(), str.capacity());
 }
 
+template <class String>
+void check_insert_chars_growing() {
+    String str("0123456789");
+    str.insert(2, 30, 'x');
+    EXPECT_EQ(str.size(), 40u);
+    EXPECT_STREQ(str.c_str(), "01xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx23456789");
+    str.insert(str.size(), 40, 'y');
+    EXPECT_EQ(str.size(), 80u);
+    EXPECT_EQ(std::string(str.c_str()), "01" + std::string(30, 'x') + "23456789" + std::string(40, 'y'));
+}
+
+TEST(string, insert_chars_growing) {
+    check_insert_chars_growing<simple::string>();
+    check_insert_chars_growing<sso::string>();
+    check_insert_chars_growing<sso3::string>();
+    check_insert_chars_growing<sso4::string>();
+    check_insert_chars_growing<sso4::cow_string>();
+}
+
 TEST(string, insert_self) {
     string str("01234");
     str.reserve(16);
@@ -356,6 +492,1978 @@ TEST(string, insert_allocations) {
     EXPECT_EQ(memory.active_allocations(), 0u);
     EXPECT_EQ(memory.active_used_memory(), 0u);
 }
+
+template <class String>
+void check_erase() {
+    String str("0123456789");
+    str.erase(2, 3);
+    EXPECT_STREQ(str.c_str(), "0156789");
+    str.erase(5, 100);
+    EXPECT_STREQ(str.c_str(), "01567");
+    str.erase(5, 1);
+    str.erase(0, 0);
+    EXPECT_STREQ(str.c_str(), "01567");
+    str.erase(0, 5);
+    EXPECT_STREQ(str.c_str(), "");
+    EXPECT_EQ(str.size(), 0u);
+}
+
+TEST(string, erase) {
+    check_erase<simple::string>();
+    check_erase<sso::string>();
+    check_erase<sso3::string>();
+    check_erase<sso4::string>();
+    check_erase<sso4::cow_string>();
+}
+
+template <class String>
+void check_replace() {
+    String str("0123456789");
+    str.replace(2, 3, "abc");
+    EXPECT_STREQ(str.c_str(), "01abc56789");
+    str.replace(0, 2, "");
+    EXPECT_STREQ(str.c_str(), "abc56789");
+    str.replace(3, 100, "loooooooooooooooooooooong string");
+    EXPECT_STREQ(str.c_str(), "abcloooooooooooooooooooooong string");
+    str.replace(0, 3, str.c_str() + str.size() - 6);
+    EXPECT_STREQ(str.c_str(), "stringloooooooooooooooooooooong string");
+    EXPECT_EQ(str.size(), 38u);
+}
+
+TEST(string, replace) {
+    check_replace<simple::string>();
+    check_replace<sso::string>();
+    check_replace<sso3::string>();
+    check_replace<sso4::string>();
+    check_replace<sso4::cow_string>();
+}
+
+template <class String>
+void check_replace_all() {
+    String str("a-b-c-d");
+    str.replace_all("-", "");
+    EXPECT_STREQ(str.c_str(), "abcd");
+    str.replace_all("", "x");
+    EXPECT_STREQ(str.c_str(), "abcd");
+    str.replace_all("bc", "BBCC");
+    EXPECT_STREQ(str.c_str(), "aBBCCd");
+    str.replace_all("x", "y");
+    EXPECT_STREQ(str.c_str(), "aBBCCd");
+
+    String long_str("one two one two one two one two one two");
+    long_str.replace_all("one", "1");
+    EXPECT_STREQ(long_str.c_str(), "1 two 1 two 1 two 1 two 1 two");
+    long_str.replace_all("two", "three");
+    EXPECT_STREQ(long_str.c_str(), "1 three 1 three 1 three 1 three 1 three");
+    long_str.replace_all("1 three ", "");
+    EXPECT_STREQ(long_str.c_str(), "1 three");
+
+    String overlapped("aaaaa");
+    overlapped.replace_all("aa", "b");
+    EXPECT_STREQ(overlapped.c_str(), "bba");
+}
+
+TEST(string, replace_all) {
+    check_replace_all<simple::string>();
+    check_replace_all<sso::string>();
+    check_replace_all<sso3::string>();
+    check_replace_all<sso4::string>();
+    check_replace_all<sso4::cow_string>();
+}
+
+TEST(string, replace_all_in_place) {
+    if (SKIP_ALLOCATIONS_TEST) return;
+
+    string str("x-x-x-x");
+    str.reserve(64);
+    allocations_recorder memory;
+    str.replace_all("x", "<xx>");
+    EXPECT_STREQ(str.c_str(), "<xx>-<xx>-<xx>-<xx>");
+    str.replace_all("<xx>", "y");
+    EXPECT_STREQ(str.c_str(), "y-y-y-y");
+    memory.stop();
+    EXPECT_EQ(memory.total_allocations(), 0u);
+}
+
+TEST(string, replace_all_allocations) {
+    if (SKIP_ALLOCATIONS_TEST) return;
+
+    std::string text;
+    for (int i = 0; i < 1000; ++i) {
+        text += "key=value;";
+    }
+    string str(text.c_str());
+    allocations_recorder memory;
+    str.replace_all("=", " := ");
+    memory.stop();
+    EXPECT_EQ(memory.total_allocations(), 1u);
+    EXPECT_EQ(str.size(), text.size() + 3000);
+}
+
+template <class String>
+void check_large_growth() {
+    String str;
+    const char* text = "0123456789";
+    const size_t count = 200000;
+    for (size_t i = 0; i < count; ++i) {
+        str.insert(str.size(), text);
+    }
+    EXPECT_EQ(str.size(), 10 * count);
+    EXPECT_GE(str.capacity(), str.size());
+    bool same = true;
+    for (size_t i = 0; i < count; ++i) {
+        same = same && std::memcmp(str.begin() + i * 10, text, 10) == 0;
+    }
+    EXPECT_TRUE(same);
+    EXPECT_EQ(str.c_str()[str.size()], 0);
+
+    str.insert(5, "abc");
+    str.resize(2 * str.size(), 'x');
+    EXPECT_EQ(std::string(str.begin(), str.begin() + 10), "01234abc56");
+    EXPECT_EQ(str.end()[-1], 'x');
+}
+
+TEST(string, large_growth) {
+    check_large_growth<simple::string>();
+    check_large_growth<sso3::string>();
+    check_large_growth<sso4::string>();
+    check_large_growth<sso4::cow_string>();
+}
+
+TEST(string, large_growth_allocations) {
+    if (SKIP_ALLOCATIONS_TEST) return;
+
+    sso3::string str;
+    str.resize(1 << 20, 'a');
+    allocations_recorder memory;
+    for (int i = 0; i < 7; ++i) {
+        str.resize(2 * str.size(), 'b');
+    }
+    str.reserve(str.size() + 1);
+    memory.stop();
+    // large buffers grow by remapping pages, not through new[] + copy
+    EXPECT_EQ(memory.total_allocations(), 0u);
+    EXPECT_EQ(str.size(), 128u << 20);
+}
+
+template <class String>
+void check_find() {
+    String str("hello, world");
+    EXPECT_EQ(str.find('o'), 4u);
+    EXPECT_EQ(str.find('o', 5), 8u);
+    EXPECT_EQ(str.find('x'), search::npos);
+    EXPECT_EQ(str.find("wor"), 7u);
+    EXPECT_EQ(str.find(""), 0u);
+    EXPECT_EQ(str.rfind('o'), 8u);
+    EXPECT_EQ(str.rfind('o', 7), 4u);
+    EXPECT_EQ(str.rfind("l"), 10u);
+    EXPECT_EQ(str.rfind("lo"), 3u);
+    EXPECT_EQ(str.find_first_of(" ,"), 5u);
+    EXPECT_EQ(str.find_first_not_of("helo"), 5u);
+
+    // old chars after the end are not found
+    str.erase(5, 100);
+    EXPECT_EQ(str.find('w'), search::npos);
+    EXPECT_EQ(str.find("wor"), search::npos);
+    EXPECT_EQ(str.rfind('o'), 4u);
+
+    String long_str("the quick brown fox jumps over the lazy dog, the quick brown fox");
+    EXPECT_EQ(long_str.find("fox"), 16u);
+    EXPECT_EQ(long_str.rfind("fox"), 61u);
+    EXPECT_EQ(long_str.rfind("the", 40), 31u);
+    EXPECT_EQ(long_str.find_first_of(",", 20), 43u);
+    EXPECT_EQ(long_str.find_first_not_of("the quick", 0), 10u);
+}
+
+TEST(string, find) {
+    check_find<simple::string>();
+    check_find<sso::string>();
+    check_find<sso3::string>();
+    check_find<sso4::string>();
+    check_find<sso4::cow_string>();
+}
+
+void check_search_kernels(const search::kernels_table& kernels) {
+    const char alphabet[] = { 'a', 'b', 'c', 0 };
+    const char* patterns[] = { "ab", "ca", "abc", "bcab", "aaaaaaaaaaaaaaaaaaaa" };
+    size_t seed = 12345;
+    for (size_t size = 0; size <= 100; ++size) {
+        std::string str;
+        for (size_t i = 0; i < size; ++i) {
+            seed = seed * 1103515245 + 12345;
+            str += alphabet[(seed >> 16) % (i % 7 == 0 ? 4 : 3)];
+        }
+        for (size_t pos = 0; pos <= size + 1; ++pos) {
+            EXPECT_EQ(kernels.find_char(str.data(), size, 'c', pos), str.find('c', pos)) << str << " " << pos;
+            EXPECT_EQ(kernels.rfind_char(str.data(), size, 'c', pos), str.rfind('c', pos)) << str << " " << pos;
+            for (auto pattern : patterns) {
+                auto pattern_size = std::strlen(pattern);
+                EXPECT_EQ(kernels.find(str.data(), size, pattern, pattern_size, pos), str.find(pattern, pos)) << str << " " << pos;
+                EXPECT_EQ(kernels.rfind(str.data(), size, pattern, pattern_size, pos), str.rfind(pattern, pos)) << str << " " << pos;
+            }
+            EXPECT_EQ(kernels.find_first_of(str.data(), size, "bc", 2, pos, false), str.find_first_of("bc", pos)) << str << " " << pos;
+            EXPECT_EQ(kernels.find_first_of(str.data(), size, "ab", 2, pos, true), str.find_first_not_of("ab", pos)) << str << " " << pos;
+        }
+        EXPECT_EQ(kernels.rfind_char(str.data(), size, 'c', search::npos), str.rfind('c')) << str;
+        EXPECT_EQ(kernels.rfind(str.data(), size, "ab", 2, search::npos), str.rfind("ab")) << str;
+    }
+}
+
+TEST(search, scalar) {
+    check_search_kernels({ search::find_char_scalar, search::rfind_char_scalar,
+        search::find_scalar, search::rfind_scalar, search::find_first_of_scalar });
+}
+
+#if HAS_SSE2
+TEST(search, sse2) {
+    check_search_kernels({ search::find_char_sse2, search::rfind_char_sse2,
+        search::find_sse2, search::rfind_sse2, search::find_first_of_sse2 });
+}
+#endif
+
+#if HAS_AVX2_DISPATCH
+TEST(search, avx2) {
+    if (!search::cpu_has_avx2()) return;
+    check_search_kernels({ search::find_char_avx2, search::rfind_char_avx2,
+        search::find_avx2, search::rfind_avx2, search::find_first_of_avx2 });
+}
+#endif
+
+TEST(search, dispatch) {
+    check_search_kernels({ search::find, search::rfind, search::find, search::rfind,
+        [](const char* str, size_t size, const char* chars, size_t chars_size, size_t from, bool negate) {
+            return negate ? search::find_first_not_of(str, size, chars, chars_size, from)
+                : search::find_first_of(str, size, chars, chars_size, from);
+        } });
+}
+
+template <class String>
+void check_compare() {
+    String a("abc");
+    String b("abd");
+    String c("abc");
+    String empty;
+    EXPECT_TRUE(a == c);
+    EXPECT_FALSE(a != c);
+    EXPECT_TRUE(a != b);
+    EXPECT_TRUE(a < b);
+    EXPECT_TRUE(b > a);
+    EXPECT_TRUE(a <= c);
+    EXPECT_TRUE(a >= c);
+    EXPECT_EQ(a.compare(c), 0);
+    EXPECT_TRUE(empty < a);
+    EXPECT_TRUE(empty == String(""));
+
+    // prefix is less, chars compare as unsigned
+    EXPECT_TRUE(String("ab") < a);
+    EXPECT_TRUE(String("a\x7f") < String("a\x80"));
+
+    // chars after the end do not matter
+    String d("abcdef");
+    d.erase(3, 3);
+    EXPECT_TRUE(d == a);
+
+    String long_a("loooooooooooooooooooooooooooooooooong string");
+    String long_b("loooooooooooooooooooooooooooooooooong strinG");
+    EXPECT_TRUE(long_a != long_b);
+    EXPECT_TRUE(long_b < long_a);
+    EXPECT_TRUE(long_a != a);
+    EXPECT_TRUE(long_a > a);
+    long_a.erase(3, 100);
+    EXPECT_TRUE(long_a == String("loo"));
+}
+
+TEST(string, compare) {
+    check_compare<simple::string>();
+    check_compare<sso::string>();
+    check_compare<sso3::string>();
+    check_compare<sso4::string>();
+    check_compare<sso4::cow_string>();
+}
+
+TEST(kernels, equal_and_compare) {
+    auto sign = [](int x) { return (x > 0) - (x < 0); };
+    for (size_t count = 0; count <= 2 * kernels::SMALL_SIZE; ++count) {
+        char a[256];
+        char b[256];
+        for (size_t i = 0; i < count; ++i) {
+            a[i] = b[i] = (char)(i * 7 + 1);
+        }
+        EXPECT_TRUE(kernels::equal(a, b, count)) << count;
+        EXPECT_EQ(kernels::compare(a, b, count), 0) << count;
+        for (size_t diff = 0; diff < count; ++diff) {
+            b[diff] = (char)(a[diff] + 0x80);
+            EXPECT_FALSE(kernels::equal(a, b, count)) << count << " " << diff;
+            EXPECT_EQ(sign(kernels::compare(a, b, count)), sign(std::memcmp(a, b, count))) << count << " " << diff;
+            EXPECT_EQ(sign(kernels::compare(b, a, count)), sign(std::memcmp(b, a, count))) << count << " " << diff;
+            b[diff] = a[diff];
+        }
+    }
+}
+
+template <class String>
+void check_hash() {
+    const char* long_text = "loooooooooooooooooooooooooooooooooong string";
+    auto expected_short = hashing::hash32("short", 5);
+    auto expected_long = hashing::hash32(long_text, std::strlen(long_text));
+    EXPECT_EQ(String("short").hash(), expected_short);
+    EXPECT_EQ(String(long_text).hash(), expected_long);
+    EXPECT_EQ(std::hash<String>{}(String(long_text)), expected_long);
+
+    // short string in a heap buffer
+    String reserved("short");
+    reserved.reserve(100);
+    EXPECT_EQ(reserved.hash(), expected_short);
+
+    // cached hash is dropped by modifications
+    String str(long_text);
+    EXPECT_EQ(str.hash(), expected_long);
+    str.insert(0, 1, 'x');
+    EXPECT_EQ(str.hash(), String(str.c_str()).hash());
+    str.erase(0, 1);
+    EXPECT_EQ(str.hash(), expected_long);
+    str.replace(0, 1, "L");
+    EXPECT_EQ(str.hash(), String(str.c_str()).hash());
+    *str.begin() = 'l';
+    EXPECT_EQ(str.hash(), expected_long);
+    str.resize(5);
+    EXPECT_EQ(str.hash(), hashing::hash32(long_text, 5));
+
+    std::unordered_set<String> set;
+    set.insert(String("one"));
+    set.insert(String(long_text));
+    EXPECT_EQ(set.count(String("one")), 1u);
+    EXPECT_EQ(set.count(String(long_text)), 1u);
+    EXPECT_EQ(set.count(String("two")), 0u);
+}
+
+TEST(string, hash) {
+    check_hash<simple::string>();
+    check_hash<sso::string>();
+    check_hash<sso3::string>();
+    check_hash<sso4::string>();
+    check_hash<sso4::cow_string>();
+}
+
+// const calls only read the cache, so a shared key may be hashed and validated by many threads
+template <class String>
+void check_hash_threads() {
+    String key("a key of a table shared by reader threads");
+    key.insert(key.size(), "!");
+    const String& shared_key = key;
+    auto expected = hashing::hash32(key.c_str(), key.size());
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches(0);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 1000; ++i) {
+                if (std::hash<String>{}(shared_key) != expected) ++mismatches;
+                if (!shared_key.validate_utf8()) ++mismatches;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(mismatches.load(), 0);
+    // the non-const call caches, copies take the value over
+    EXPECT_EQ(key.hash(), expected);
+    String copy = key;
+    EXPECT_EQ(static_cast<const String&>(copy).hash(), expected);
+}
+
+TEST(string, hash_threads) {
+    check_hash_threads<sso3::string>();
+    check_hash_threads<sso4::string>();
+    check_hash_threads<sso4::cow_string>();
+}
+
+TEST(hashing, prefixes) {
+    // every prefix of a text and every single char change gives a new hash
+    char text[200];
+    for (size_t i = 0; i < sizeof(text); ++i) {
+        text[i] = (char)('a' + i % 26);
+    }
+    std::unordered_set<uint64_t> hashes;
+    for (size_t size = 0; size <= sizeof(text); ++size) {
+        EXPECT_TRUE(hashes.insert(hashing::hash(text, size)).second) << size;
+    }
+    for (size_t i = 0; i < sizeof(text); ++i) {
+        text[i] ^= 1;
+        EXPECT_TRUE(hashes.insert(hashing::hash(text, sizeof(text))).second) << i;
+        text[i] ^= 1;
+    }
+}
+
+template <class String>
+void check_case() {
+    String str("Content-Type");
+    str.to_lower();
+    EXPECT_STREQ(str.c_str(), "content-type");
+    str.to_upper();
+    EXPECT_STREQ(str.c_str(), "CONTENT-TYPE");
+
+    String long_str("X-Forwarded-For: 127.0.0.1, [@`{] \xc0\xe0");
+    auto hash = long_str.hash();
+    long_str.to_lower();
+    EXPECT_STREQ(long_str.c_str(), "x-forwarded-for: 127.0.0.1, [@`{] \xc0\xe0");
+    EXPECT_NE(long_str.hash(), hash);
+    long_str.to_upper();
+    EXPECT_STREQ(long_str.c_str(), "X-FORWARDED-FOR: 127.0.0.1, [@`{] \xc0\xe0");
+
+    EXPECT_TRUE(String("Accept").iequals(String("aCCEPT")));
+    EXPECT_FALSE(String("Accept").iequals(String("Accepts")));
+    EXPECT_FALSE(String("[").iequals(String("{")));
+    EXPECT_EQ(String("Accept").icompare(String("ACCEPT")), 0);
+    EXPECT_LT(String("accept").icompare(String("ACCEPTS")), 0);
+    EXPECT_LT(String("ABC").icompare(String("abd")), 0);
+    EXPECT_GT(String("b").icompare(String("A")), 0);
+    EXPECT_EQ(String("X-Forwarded-For").ihash(), String("x-forwarded-for").ihash());
+    EXPECT_EQ(String("x-forwarded-for").ihash(), String("x-forwarded-for").hash());
+}
+
+TEST(string, to_lower_to_upper) {
+    check_case<simple::string>();
+    check_case<sso::string>();
+    check_case<sso3::string>();
+    check_case<sso4::string>();
+    check_case<sso4::cow_string>();
+}
+
+TEST(ascii, case_conversion) {
+    char source[300];
+    for (size_t i = 0; i < sizeof(source); ++i) {
+        source[i] = (char)(i * 37 + i / 256);
+    }
+    for (size_t size = 0; size <= sizeof(source) - 2; ++size) {
+        std::string lower(source + 1, size);
+        std::string upper(source + 1, size);
+        for (auto& ch : lower) ch = (char)std::tolower((unsigned char)ch);
+        for (auto& ch : upper) ch = (char)std::toupper((unsigned char)ch);
+
+        char actual[sizeof(source)];
+        std::memcpy(actual, source, sizeof(source));
+        ascii::to_lower(actual + 1, size);
+        EXPECT_EQ(std::string(actual + 1, size), lower) << size;
+        EXPECT_EQ(actual[0], source[0]);
+        EXPECT_EQ(actual[size + 1], source[size + 1]);
+        EXPECT_TRUE(ascii::iequal(actual + 1, upper.data(), size)) << size;
+        EXPECT_EQ(ascii::icompare(actual + 1, upper.data(), size), 0) << size;
+        EXPECT_EQ(ascii::ihash32(upper.data(), size), hashing::hash32(lower.data(), size)) << size;
+
+        std::memcpy(actual, source, sizeof(source));
+        ascii::to_upper(actual + 1, size);
+        EXPECT_EQ(std::string(actual + 1, size), upper) << size;
+
+        if (size > 0) {
+            // a change in any position is found
+            auto pos = size * 7 % size;
+            lower[pos] = lower[pos] == 'z' ? 'y' : (char)(lower[pos] + 1);
+            EXPECT_FALSE(ascii::iequal(lower.data(), upper.data(), size)) << size;
+            EXPECT_NE(ascii::icompare(lower.data(), upper.data(), size), 0) << size;
+        }
+    }
+}
+
+template <class String>
+void check_utf8() {
+    EXPECT_TRUE(String("").validate_utf8());
+    EXPECT_TRUE(String("\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82").validate_utf8());
+    EXPECT_EQ(String("\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82").count_code_points(), 6u);
+    EXPECT_FALSE(String("\xc0\xaf").validate_utf8());
+
+    // cached result is dropped by modifications
+    String str("price: 100 \xe2\x82\xac, 200 \xe2\x82\xac, 300 \xe2\x82\xac");
+    EXPECT_TRUE(str.validate_utf8());
+    EXPECT_TRUE(str.validate_utf8());
+    EXPECT_EQ(str.count_code_points(), 26u);
+    str.insert(0, "\xff");
+    EXPECT_FALSE(str.validate_utf8());
+    str.erase(0, 1);
+    EXPECT_TRUE(str.validate_utf8());
+    str.erase(12, 1);
+    EXPECT_FALSE(str.validate_utf8());
+}
+
+TEST(string, utf8) {
+    check_utf8<simple::string>();
+    check_utf8<sso::string>();
+    check_utf8<sso3::string>();
+    check_utf8<sso4::string>();
+}
+
+TEST(utf8, validate) {
+    struct {
+        const char* text;
+        bool valid;
+    } cases[] = {
+        { "a", true },
+        { "\xc3\xa9", true },
+        { "\xe2\x82\xac", true },
+        { "\xf0\x9d\x84\x9e", true },
+        { "\xed\x9f\xbf", true },               // U+D7FF
+        { "\xf4\x8f\xbf\xbf", true },           // U+10FFFF
+        { "\x80", false },                      // lone continuation
+        { "\xc3", false },                      // truncated
+        { "\xe2\x82", false },
+        { "\xf0\x9d\x84", false },
+        { "\xc3\xa9\xa9", false },              // too long
+        { "\xc0\xaf", false },                  // overlong
+        { "\xc1\xbf", false },
+        { "\xe0\x80\xaf", false },
+        { "\xe0\x9f\xbf", false },
+        { "\xf0\x80\x80\xaf", false },
+        { "\xf0\x8f\xbf\xbf", false },
+        { "\xed\xa0\x80", false },              // surrogate
+        { "\xed\xbf\xbf", false },
+        { "\xf4\x90\x80\x80", false },          // above U+10FFFF
+        { "\xf5\x80\x80\x80", false },
+        { "\xf8\x88\x80\x80\x80", false },
+        { "\xff", false },
+        { "\xe2\x82\x41", false },              // ASCII inside a code point
+    };
+    for (auto& c : cases) {
+        // at every position around 32-char blocks
+        for (size_t before = 0; before < 70; before += 3) {
+            for (size_t after = 0; after < 40; after += 13) {
+                auto text = std::string(before, 'x') + c.text + std::string(after, 'y');
+                EXPECT_EQ(utf8::validate(text.data(), text.size()), c.valid) << before << " " << after << " " << text;
+                EXPECT_EQ(utf8::validate_scalar(text.data(), text.size()), c.valid) << before << " " << after << " " << text;
+            }
+        }
+    }
+}
+
+TEST(utf8, random_texts) {
+    const char* tokens[] = { "a", "z", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xed\x9f\xbf" };
+    size_t seed = 12345;
+    for (int test = 0; test < 2000; ++test) {
+        std::string text;
+        size_t code_points = 0;
+        seed = seed * 1103515245 + 12345;
+        auto length = (seed >> 16) % 100;
+        for (size_t i = 0; i < length; ++i) {
+            seed = seed * 1103515245 + 12345;
+            text += tokens[(seed >> 16) % 6];
+            ++code_points;
+        }
+        EXPECT_TRUE(utf8::validate(text.data(), text.size())) << text;
+        EXPECT_EQ(utf8::count_code_points(text.data(), text.size()), code_points);
+        if (text.empty()) continue;
+        // one random byte breaks some texts
+        seed = seed * 1103515245 + 12345;
+        text[(seed >> 16) % text.size()] = (char)(seed >> 8);
+        auto expected = utf8::validate_scalar(text.data(), text.size());
+        EXPECT_EQ(utf8::validate(text.data(), text.size()), expected) << text;
+#if HAS_AVX2_DISPATCH
+        if (kernels::cpu_has_avx2()) {
+            EXPECT_EQ(utf8::validate_avx2(text.data(), text.size()), expected) << text;
+        }
+#endif
+    }
+}
+
+std::vector<multi_search::match> naive_find_all(const std::vector<std::string>& patterns, const std::string& text) {
+    std::vector<multi_search::match> res;
+    for (size_t pattern = 0; pattern < patterns.size(); ++pattern) {
+        if (patterns[pattern].empty()) continue;
+        for (auto pos = text.find(patterns[pattern]); pos != std::string::npos; pos = text.find(patterns[pattern], pos + 1)) {
+            res.push_back(multi_search::match{ pattern, pos });
+        }
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+TEST(multi_search, keywords) {
+    std::vector<sso3::string> keywords = { "he", "she", "his", "hers", "" };
+    multi_search::matcher matcher(keywords);
+    EXPECT_EQ(matcher.size(), 5u);
+    sso3::string text("ushers said his hershey");
+    auto matches = matcher.find_all(text);
+    std::vector<multi_search::match> expected = {
+        { 1, 1 }, { 0, 2 }, { 3, 2 }, { 2, 12 }, { 0, 16 }, { 3, 16 }, { 1, 19 }, { 0, 20 } };
+    EXPECT_EQ(matches, expected);
+}
+
+TEST(multi_search, random_patterns) {
+    size_t seed = 12345;
+    auto random = [&seed](size_t limit) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % limit;
+    };
+    for (size_t count : { 1, 3, 8, 20, 32, 33, 300 }) {
+        std::vector<std::string> patterns;
+        for (size_t i = 0; i < count; ++i) {
+            std::string pattern;
+            auto length = 1 + random(count > 32 ? 8 : 4);
+            for (size_t k = 0; k < length; ++k) {
+                pattern += (char)('a' + random(4));
+            }
+            patterns.push_back(pattern);
+        }
+        multi_search::matcher matcher(patterns);
+#if HAS_AVX2_DISPATCH
+        EXPECT_EQ(matcher.uses_teddy(), count <= 32 && kernels::cpu_has_avx2());
+#endif
+        for (size_t size : { 0, 1, 31, 32, 33, 100, 1000 }) {
+            std::string text;
+            for (size_t i = 0; i < size; ++i) {
+                text += (char)('a' + random(5));
+            }
+            auto expected = naive_find_all(patterns, text);
+            EXPECT_EQ(matcher.find_all(text), expected) << count << " " << size;
+
+            // the same text in random chunks
+            std::vector<multi_search::match> streamed;
+            auto stream = matcher.make_stream();
+            for (size_t pos = 0; pos < size;) {
+                auto chunk = std::min(size - pos, 1 + random(50));
+                stream.feed(text.data() + pos, chunk, [&streamed](size_t pattern, size_t position) {
+                    streamed.push_back(multi_search::match{ pattern, position });
+                });
+                pos += chunk;
+            }
+            std::sort(streamed.begin(), streamed.end());
+            EXPECT_EQ(streamed, expected) << count << " " << size;
+        }
+    }
+}
+
+template <class Range>
+std::vector<std::string> collect(const Range& range) {
+    std::vector<std::string> res;
+    for (auto token : range) {
+        res.emplace_back(token.data, token.size);
+    }
+    return res;
+}
+
+template <class String>
+void check_split() {
+    typedef std::vector<std::string> tokens;
+    EXPECT_EQ(collect(String("a,b,,c,").split(',')), tokens({ "a", "b", "", "c", "" }));
+    EXPECT_EQ(collect(String("").split(',')), tokens({ "" }));
+    EXPECT_EQ(collect(String("").split(',').skip_empty()), tokens());
+    EXPECT_EQ(collect(String("no separators").split(';')), tokens({ "no separators" }));
+    EXPECT_EQ(collect(String("ns::detail::impl").split("::")), tokens({ "ns", "detail", "impl" }));
+    EXPECT_EQ(collect(String("ns::detail::impl").split("")), tokens({ "ns::detail::impl" }));
+    EXPECT_EQ(collect(String(" key =\tvalue  ").split_any_of(" =\t").skip_empty()), tokens({ "key", "value" }));
+    EXPECT_EQ(String("1 2  3").split(' ').count(), 4u);
+    EXPECT_EQ(String("1 2  3").split(' ').skip_empty().count(), 3u);
+
+    // tokens point into the string, iterating allocates nothing
+    String line("2024-01-15 12:00:01 INFO [connection-pool-worker-17] connection established");
+    allocations_recorder memory;
+    size_t count = 0;
+    for (auto token : line.split(' ')) {
+        EXPECT_GE(token.data, line.c_str());
+        EXPECT_LE(token.data + token.size, line.c_str() + line.size());
+        ++count;
+    }
+    auto level = ++line.split(' ').begin();
+    EXPECT_TRUE(*++level == "INFO");
+    memory.stop();
+    EXPECT_EQ(count, 6u);
+    if (!SKIP_ALLOCATIONS_TEST) {
+        EXPECT_EQ(memory.total_allocations(), 0u);
+    }
+}
+
+TEST(string, split) {
+    check_split<simple::string>();
+    check_split<sso::string>();
+    check_split<sso3::string>();
+    check_split<sso4::string>();
+    check_split<sso4::cow_string>();
+}
+
+TEST(splitting, random_texts) {
+    size_t seed = 777;
+    auto random = [&seed](size_t limit) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % limit;
+    };
+    // std::string based reference
+    auto naive_split = [](const std::string& text, const std::string& delimiters, bool any_of) {
+        std::vector<std::string> res;
+        size_t start = 0;
+        for (;;) {
+            auto pos = any_of ? text.find_first_of(delimiters, start) : text.find(delimiters, start);
+            if (pos == std::string::npos) break;
+            res.push_back(text.substr(start, pos - start));
+            start = pos + (any_of ? 1 : delimiters.size());
+        }
+        res.push_back(text.substr(start));
+        return res;
+    };
+    for (size_t size : { 0, 1, 15, 16, 17, 63, 64, 65, 200, 1000 }) {
+        std::string text;
+        for (size_t i = 0; i < size; ++i) {
+            text += "ab,;"[random(4)];
+        }
+        EXPECT_EQ(collect(splitting::by_char(text.data(), text.size(), ',')), naive_split(text, ",", false)) << text;
+        EXPECT_EQ(collect(splitting::by_substring(text.data(), text.size(), ",;")), naive_split(text, ",;", false)) << text;
+        EXPECT_EQ(collect(splitting::by_any_of(text.data(), text.size(), ",;")), naive_split(text, ",;", true)) << text;
+
+        auto expected = naive_split(text, ",;", true);
+        expected.erase(std::remove(expected.begin(), expected.end(), std::string()), expected.end());
+        EXPECT_EQ(collect(splitting::by_any_of(text.data(), text.size(), ",;").skip_empty()), expected) << text;
+    }
+}
+
+template <class String>
+void check_numbers() {
+    EXPECT_STREQ(String::from_number(0).c_str(), "0");
+    EXPECT_STREQ(String::from_number(-42).c_str(), "-42");
+    EXPECT_STREQ(String::from_number(INT64_MIN).c_str(), "-9223372036854775808");
+    EXPECT_STREQ(String::from_number(UINT64_MAX).c_str(), "18446744073709551615");
+    EXPECT_STREQ(String::from_number((unsigned char)200).c_str(), "200");
+    EXPECT_STREQ(String::from_number(0.1).c_str(), "0.1");
+    EXPECT_STREQ(String::from_number(0.1f).c_str(), "0.1");
+    EXPECT_STREQ(String::from_number(-0.0).c_str(), "-0");
+    EXPECT_STREQ(String::from_number(100.0).c_str(), "100");
+    EXPECT_STREQ(String::from_number(123.456).c_str(), "123.456");
+    EXPECT_STREQ(String::from_number(0.001).c_str(), "0.001");
+    EXPECT_STREQ(String::from_number(0.0001).c_str(), "1e-04");
+    EXPECT_STREQ(String::from_number(1e22).c_str(), "1e+22");
+    EXPECT_STREQ(String::from_number(1.5e300).c_str(), "1.5e+300");
+    EXPECT_STREQ(String::from_number(5e-324).c_str(), "5e-324");
+    EXPECT_STREQ(String::from_number(1.7976931348623157e308).c_str(), "1.7976931348623157e+308");
+    EXPECT_STREQ(String::from_number(-2.2250738585072014e-308).c_str(), "-2.2250738585072014e-308");
+    EXPECT_STREQ(String::from_number(9007199254740993.0).c_str(), "9007199254740992");
+    EXPECT_STREQ(String::from_number(std::numeric_limits<double>::infinity()).c_str(), "inf");
+    EXPECT_STREQ(String::from_number(-std::numeric_limits<float>::infinity()).c_str(), "-inf");
+    EXPECT_STREQ(String::from_number(std::numeric_limits<double>::quiet_NaN()).c_str(), "nan");
+
+    String str("x=");
+    str.append_number(-7);
+    str.append_number(0.25);
+    EXPECT_STREQ(str.c_str(), "x=-70.25");
+}
+
+TEST(string, numbers) {
+    check_numbers<simple::string>();
+    check_numbers<sso::string>();
+    check_numbers<sso3::string>();
+    check_numbers<sso4::string>();
+    check_numbers<sso4::cow_string>();
+}
+
+template <class String>
+void check_number_allocations() {
+    allocations_recorder memory;
+    {
+        auto str = String::from_number(-123456789012345678ll);
+        str.append_number(2.5);
+        auto pi = String::from_number(3.141592653589793);
+        EXPECT_STREQ(str.c_str(), "-1234567890123456782.5");
+        EXPECT_STREQ(pi.c_str(), "3.141592653589793");
+    }
+    memory.stop();
+    EXPECT_EQ(memory.total_allocations(), 0u);
+}
+
+TEST(string, number_allocations) {
+    if (SKIP_ALLOCATIONS_TEST) return;
+    check_number_allocations<sso3::string>();
+    check_number_allocations<sso4::string>();
+    check_number_allocations<sso4::cow_string>();
+}
+
+// number of significant digits printf needs to read back the same value
+template <class Number>
+int shortest_digits(Number value, Number (*parse)(const char*, char**)) {
+    char buffer[64];
+    for (int digits = 1;; ++digits) {
+        std::snprintf(buffer, sizeof(buffer), "%.*e", digits - 1, (double)value);
+        if (parse(buffer, nullptr) == value) return digits;
+    }
+}
+
+int significant_digits(const std::string& str) {
+    std::string digits;
+    for (auto ch : str.substr(0, str.find('e'))) {
+        if (ch >= '0' && ch <= '9') digits += ch;
+    }
+    digits.erase(0, std::min(digits.find_first_not_of('0'), digits.size()));
+    digits.erase(digits.find_last_not_of('0') + 1);
+    return (int)digits.size();
+}
+
+template <class Number, class Bits>
+void check_random_numbers(Number (*parse)(const char*, char**)) {
+    uint64_t seed = 4242;
+    for (int i = 0; i < 20000; ++i) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        auto bits = (Bits)(seed >> (64 - sizeof(Bits) * 8));
+        if (i % 4 == 0) {
+            // small integers and simple fractions
+            bits = 0;
+            Number value = (Number)(int)(seed >> 40) / (Number)(1 << (seed >> 60));
+            std::memcpy(&bits, &value, sizeof(value));
+        }
+        Number value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (value != value || value - value != 0) continue;  // nan or inf
+
+        char buffer[numbers::MAX_CHARS + 1];
+        auto size = numbers::format(buffer, value);
+        ASSERT_LE(size, 24u);
+        buffer[size] = 0;
+        EXPECT_EQ(parse(buffer, nullptr), value) << buffer;
+        if (value != 0) {
+            EXPECT_EQ(significant_digits(buffer), shortest_digits(value, parse)) << buffer;
+        }
+    }
+}
+
+TEST(numbers, random_doubles) {
+    check_random_numbers<double, uint64_t>(std::strtod);
+}
+
+TEST(numbers, random_floats) {
+    check_random_numbers<float, uint32_t>(std::strtof);
+}
+
+TEST(numbers, integers) {
+    char buffer[numbers::MAX_CHARS];
+    uint64_t value = 1;
+    for (int i = 0; i < 64; ++i, value = value * 3 + i) {
+        EXPECT_EQ(std::string(buffer, numbers::format(buffer, value)), std::to_string(value));
+        EXPECT_EQ(std::string(buffer, numbers::format(buffer, -(int64_t)(value >> 1))), std::to_string(-(int64_t)(value >> 1)));
+    }
+}
+
+template <class String>
+void check_parse() {
+    int64_t int_value = 5;
+    EXPECT_EQ(String("-9223372036854775808").parse_int(int_value), numbers::PARSE_OK);
+    EXPECT_EQ(int_value, INT64_MIN);
+    EXPECT_EQ(String("000000000000000000000123").parse_int(int_value), numbers::PARSE_OK);
+    EXPECT_EQ(int_value, 123);
+    EXPECT_EQ(String("9223372036854775808").parse_int(int_value), numbers::PARSE_OUT_OF_RANGE);
+    EXPECT_EQ(String("12345678x").parse_int(int_value), numbers::PARSE_INVALID);
+    EXPECT_EQ(String("").parse_int(int_value), numbers::PARSE_INVALID);
+    EXPECT_EQ(String("-").parse_int(int_value), numbers::PARSE_INVALID);
+    EXPECT_EQ(String("+1").parse_int(int_value), numbers::PARSE_INVALID);
+    EXPECT_EQ(int_value, 123);
+
+    uint64_t uint_value = 0;
+    EXPECT_EQ(String("18446744073709551615").parse_uint(uint_value), numbers::PARSE_OK);
+    EXPECT_EQ(uint_value, UINT64_MAX);
+    EXPECT_EQ(String("18446744073709551616").parse_uint(uint_value), numbers::PARSE_OUT_OF_RANGE);
+    EXPECT_EQ(String("28446744073709551615").parse_uint(uint_value), numbers::PARSE_OUT_OF_RANGE);
+    EXPECT_EQ(String("99999999999999999999").parse_uint(uint_value), numbers::PARSE_OUT_OF_RANGE);
+    EXPECT_EQ(String("-1").parse_uint(uint_value), numbers::PARSE_INVALID);
+
+    double double_value = 0;
+    EXPECT_EQ(String("-12.5e-1").parse_double(double_value), numbers::PARSE_OK);
+    EXPECT_EQ(double_value, -1.25);
+    EXPECT_EQ(String(".5").parse_double(double_value), numbers::PARSE_OK);
+    EXPECT_EQ(double_value, 0.5);
+    EXPECT_EQ(String("5.").parse_double(double_value), numbers::PARSE_OK);
+    EXPECT_EQ(double_value, 5.0);
+    EXPECT_EQ(String("9007199254740993").parse_double(double_value), numbers::PARSE_OK);
+    EXPECT_EQ(double_value, 9007199254740992.0);
+    EXPECT_EQ(String("1e-400").parse_double(double_value), numbers::PARSE_OK);
+    EXPECT_EQ(double_value, 0.0);
+    EXPECT_EQ(String("-INF").parse_double(double_value), numbers::PARSE_OK);
+    EXPECT_EQ(double_value, -std::numeric_limits<double>::infinity());
+    EXPECT_EQ(String("NaN").parse_double(double_value), numbers::PARSE_OK);
+    EXPECT_NE(double_value, double_value);
+    double_value = 1;
+    EXPECT_EQ(String("1e400").parse_double(double_value), numbers::PARSE_OUT_OF_RANGE);
+    EXPECT_EQ(String("1e").parse_double(double_value), numbers::PARSE_INVALID);
+    EXPECT_EQ(String(".").parse_double(double_value), numbers::PARSE_INVALID);
+    EXPECT_EQ(String("1.5 ").parse_double(double_value), numbers::PARSE_INVALID);
+    EXPECT_EQ(String("infinite").parse_double(double_value), numbers::PARSE_INVALID);
+    EXPECT_EQ(double_value, 1.0);
+
+    // round trip with from_number
+    for (double number : { 0.1, 1.0 / 3, 6.02214076e23, 5e-324, 1.7976931348623157e308 }) {
+        EXPECT_EQ(String::from_number(number).parse_double(double_value), numbers::PARSE_OK);
+        EXPECT_EQ(double_value, number);
+    }
+}
+
+TEST(string, parse) {
+    check_parse<simple::string>();
+    check_parse<sso::string>();
+    check_parse<sso3::string>();
+    check_parse<sso4::string>();
+    check_parse<sso4::cow_string>();
+}
+
+TEST(numbers, parse_digits) {
+    for (uint64_t i = 0; i < 100000000; i += 1234567) {
+        char buffer[9];
+        std::snprintf(buffer, sizeof(buffer), "%08llu", (unsigned long long)i);
+        EXPECT_TRUE(numbers::is_eight_digits(kernels::load8(buffer)));
+        EXPECT_EQ(numbers::parse_eight_digits(kernels::load8(buffer)), i);
+    }
+    for (char ch : { '/', ':', 'a', ' ', '\x80', '\xb0' }) {
+        char buffer[] = "12345678";
+        buffer[5] = ch;
+        EXPECT_FALSE(numbers::is_eight_digits(kernels::load8(buffer)));
+    }
+}
+
+const uint64_t DOUBLE_SIGN_BIT = 1ull << 63;
+
+TEST(numbers, parse_random_doubles) {
+    uint64_t seed = 98765;
+    auto random = [&seed]() {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return seed;
+    };
+    char buffer[128];
+    for (int i = 0; i < 30000; ++i) {
+        switch (i % 4) {
+        case 0: {
+            // any finite double with 17 digits
+            auto bits = random() & ~DOUBLE_SIGN_BIT;
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            if (value - value != 0) continue;
+            std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+            break;
+        }
+        case 1: {
+            // short decimals like in CSV files
+            std::snprintf(buffer, sizeof(buffer), "%llu.%llu", (unsigned long long)(random() >> 44), (unsigned long long)(random() >> 50));
+            break;
+        }
+        case 2: {
+            // digits and exponent from all of the range
+            std::snprintf(buffer, sizeof(buffer), "%llue%d", (unsigned long long)(random() >> (random() >> 58)), (int)(random() >> 54) - 512);
+            break;
+        }
+        default: {
+            // long numbers near halfway points
+            std::snprintf(buffer, sizeof(buffer), "%.40e", (double)(random() >> 11) + 0.5);
+            break;
+        }
+        }
+        double value = -1;
+        auto expected = std::strtod(buffer, nullptr);
+        if (expected == std::numeric_limits<double>::infinity()) {
+            EXPECT_EQ(numbers::parse_double(buffer, std::strlen(buffer), value), numbers::PARSE_OUT_OF_RANGE) << buffer;
+            continue;
+        }
+        ASSERT_EQ(numbers::parse_double(buffer, std::strlen(buffer), value), numbers::PARSE_OK) << buffer;
+        uint64_t bits, expected_bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        std::memcpy(&expected_bits, &expected, sizeof(expected_bits));
+        EXPECT_EQ(bits, expected_bits) << buffer;
+    }
+}
+
+TEST(numbers, parse_hard_doubles) {
+    // halfway points, subnormals and the borders of the range
+    for (auto str : { "2.2250738585072011e-308", "2.2250738585072012e-308", "4.9406564584124654e-324",
+            "2.4703282292062327e-324", "2.4703282292062328e-324", "1.7976931348623158e308",
+            "9007199254740993.000000000000000000001", "9007199254740992.999999999999999999999",
+            "7.3177701707893310e+15", "0.000000000000000000000000000000000000000000001e45",
+            "123456789012345678901234567890e-10", "1e-342", "1e308", "1e23", "8.589973e9" }) {
+        double value = 0;
+        ASSERT_EQ(numbers::parse_double(str, std::strlen(str), value), numbers::PARSE_OK) << str;
+        EXPECT_EQ(value, std::strtod(str, nullptr)) << str;
+    }
+}
+
+size_t naive_edit_distance(const std::string& a, const std::string& b) {
+    std::vector<size_t> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) row[j] = j;
+    for (size_t i = 1; i <= a.size(); ++i) {
+        auto diagonal = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= b.size(); ++j) {
+            auto above = row[j];
+            row[j] = std::min({ above + 1, row[j - 1] + 1, diagonal + (a[i - 1] != b[j - 1]) });
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+template <class String>
+void check_edit_distance() {
+    EXPECT_EQ(String("kitten").edit_distance(String("sitting")), 3u);
+    EXPECT_EQ(String("").edit_distance(String("abc")), 3u);
+    EXPECT_EQ(String("flaw").edit_distance(String("lawn")), 2u);
+    EXPECT_EQ(String("same string").edit_distance(String("same string")), 0u);
+    String long_a("the quick brown fox jumps over the lazy dog and keeps running far away");
+    String long_b("the quick brown cat jumped over a lazy dog and keeps running far away!");
+    EXPECT_EQ(long_a.edit_distance(long_b), 9u);
+    EXPECT_EQ(long_a.bounded_edit_distance(long_b, 9), 9u);
+    EXPECT_EQ(long_a.bounded_edit_distance(long_b, 3), 4u);
+    EXPECT_EQ(String("short").bounded_edit_distance(long_a, 5), 6u);
+}
+
+TEST(string, edit_distance) {
+    check_edit_distance<simple::string>();
+    check_edit_distance<sso::string>();
+    check_edit_distance<sso3::string>();
+    check_edit_distance<sso4::string>();
+    check_edit_distance<sso4::cow_string>();
+}
+
+TEST(levenshtein, random_pairs) {
+    size_t seed = 31337;
+    auto random = [&seed](size_t limit) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % limit;
+    };
+    for (int i = 0; i < 600; ++i) {
+        std::string a, b;
+        auto a_size = random(i % 3 == 0 ? 200 : 70);
+        for (size_t k = 0; k < a_size; ++k) a += (char)('a' + random(4));
+        // b is an edited copy of a or an unrelated string
+        if (i % 2) {
+            b = a;
+            for (auto edits = random(12); edits > 0 && !b.empty(); --edits) {
+                auto pos = random(b.size());
+                switch (random(3)) {
+                case 0: b[pos] = (char)('a' + random(4)); break;
+                case 1: b.erase(pos, 1); break;
+                default: b.insert(pos, 1, (char)('a' + random(4))); break;
+                }
+            }
+        }
+        else {
+            auto b_size = random(i % 3 == 0 ? 200 : 70);
+            for (size_t k = 0; k < b_size; ++k) b += (char)('a' + random(4));
+        }
+        auto expected = naive_edit_distance(a, b);
+        EXPECT_EQ(levenshtein::distance(a.data(), a.size(), b.data(), b.size()), expected) << a << " " << b;
+        for (size_t bound : { 0, 1, 5, 20, 100 }) {
+            EXPECT_EQ(levenshtein::distance(a.data(), a.size(), b.data(), b.size(), bound), std::min(expected, bound + 1));
+        }
+        levenshtein::query query(a.data(), a.size());
+        EXPECT_EQ(query.distance(b.data(), b.size()), expected) << a << " " << b;
+        EXPECT_EQ(query.distance(b.data(), b.size(), 7), std::min<size_t>(expected, 8));
+    }
+}
+
+TEST(levenshtein, batch) {
+    sso3::string query_string("color");
+    levenshtein::query query(query_string.c_str(), query_string.size());
+    std::vector<sso3::string> candidates = { "colour", "color", "collar", "dolor", "", "discolored" };
+    EXPECT_EQ(query.distances(candidates), std::vector<size_t>({ 1, 0, 2, 1, 5, 5 }));
+    EXPECT_EQ(query.distances(candidates, 1), std::vector<size_t>({ 1, 0, 2, 1, 2, 2 }));
+}
+
+template <class String>
+void check_static_chars() {
+    using literals::operator"" _static;
+    static const char LITERAL[] = "a configuration key longer than the inline buffer";
+    {
+        allocations_recorder memory;
+        String str = "a configuration key longer than the inline buffer"_static;
+        String copy = str;
+        String assigned;
+        assigned = copy;
+        String small = "short key"_static;
+        EXPECT_EQ(str.size(), sizeof(LITERAL) - 1);
+        EXPECT_EQ(str.hash(), hashing::hash32(LITERAL, sizeof(LITERAL) - 1));
+        EXPECT_EQ(copy.c_str(), str.c_str());
+        EXPECT_EQ(assigned.c_str(), str.c_str());
+        EXPECT_STREQ(small.c_str(), "short key");
+        memory.stop();
+        if (!SKIP_ALLOCATIONS_TEST) {
+            EXPECT_EQ(memory.total_allocations(), 0u);
+        }
+    }
+
+    // every change copies the chars first, the literal is never written
+    String str = literals::static_chars{ LITERAL, sizeof(LITERAL) - 1 };
+    EXPECT_EQ(str.c_str(), LITERAL);
+    auto check_copied = [&](String changed, const char* expected, void (*change)(String&)) {
+        change(changed);
+        EXPECT_STREQ(changed.c_str(), expected);
+        EXPECT_NE(changed.c_str(), LITERAL);
+        EXPECT_STREQ(LITERAL, "a configuration key longer than the inline buffer");
+    };
+    check_copied(str, "a configuration key", [](String& s) { s.erase(19, 100); });
+    check_copied(str, "a configuration key", [](String& s) { s.resize(19); });
+    check_copied(str, "A CONFIGURATION KEY LONGER THAN THE INLINE BUFFER", [](String& s) { s.to_upper(); });
+    check_copied(str, "a configuration value longer than the inline buffer", [](String& s) { s.replace(16, 3, "value"); });
+    check_copied(str, "a configuration k longer than the inline buffer", [](String& s) { s.replace(17, 2, ""); });
+    check_copied(str, "a_configuration_key_longer_than_the_inline_buffer", [](String& s) { s.replace_all(" ", "_"); });
+    check_copied(str, "a configuration key longer than the inline buffer!", [](String& s) { s.insert(s.size(), "!"); });
+    check_copied(str, "b configuration key longer than the inline buffer", [](String& s) { *s.begin() = 'b'; });
+    check_copied(str, "short", [](String& s) { s = String("short"); EXPECT_EQ(s.capacity(), 22u); });
+    check_copied(str, "a configuration key longer than the inline buffer", [](String& s) { s.reserve(100); });
+    EXPECT_EQ(str.c_str(), LITERAL);
+    str.insert(0, "copied ");
+    EXPECT_STREQ(str.c_str(), "copied a configuration key longer than the inline buffer");
+}
+
+TEST(string, static_chars) {
+    check_static_chars<sso3::string>();
+    check_static_chars<sso4::string>();
+    check_static_chars<sso4::cow_string>();
+
+    // a shared string can't take over static chars
+    using literals::operator"" _static;
+    sso4::string str = "a literal that make_const has to copy"_static;
+    auto data = str.c_str();
+    auto shared_str = shared::make_const(std::move(str));
+    EXPECT_NE(shared_str.c_str(), data);
+    EXPECT_STREQ(shared_str.c_str(), "a literal that make_const has to copy");
+}
+
+TEST(const_string, basics) {
+    static_assert(sizeof(shared::const_string) == sizeof(void*), "const_string is not one pointer");
+    shared::const_string empty;
+    EXPECT_STREQ(empty.c_str(), "");
+    EXPECT_TRUE(empty.empty());
+
+    shared::const_string small("inline");
+    EXPECT_STREQ(small.c_str(), "inline");
+    EXPECT_EQ(small.size(), 6u);
+    EXPECT_EQ(small.use_count(), 1u);
+    EXPECT_GE(small.c_str(), reinterpret_cast<const char*>(&small));
+    EXPECT_LT(small.c_str(), reinterpret_cast<const char*>(&small + 1));
+
+    shared::const_string long_string("shared between all copies");
+    EXPECT_EQ(long_string.use_count(), 1u);
+    {
+        auto copy = long_string;
+        shared::const_string assigned;
+        assigned = copy;
+        EXPECT_EQ(long_string.use_count(), 3u);
+        EXPECT_EQ(copy.c_str(), long_string.c_str());
+        EXPECT_EQ(assigned, long_string);
+
+        auto moved = std::move(copy);
+        EXPECT_EQ(long_string.use_count(), 3u);
+        EXPECT_TRUE(copy.empty());
+    }
+    EXPECT_EQ(long_string.use_count(), 1u);
+
+    shared::const_string with_zero("a\0b", 3);
+    EXPECT_EQ(with_zero.size(), 3u);
+    EXPECT_NE(with_zero, shared::const_string("a"));
+
+    std::unordered_set<shared::const_string> set = { long_string, small, shared::const_string("inline") };
+    EXPECT_EQ(set.size(), 2u);
+    EXPECT_EQ(set.count(shared::const_string("shared between all copies")), 1u);
+}
+
+TEST(const_string, allocations) {
+    if (SKIP_ALLOCATIONS_TEST) return;
+    allocations_recorder memory;
+    {
+        // one allocation for the header and the chars
+        shared::const_string str("not so short string");
+        auto copy = str;
+        shared::const_string small("small");
+        auto small_copy = small;
+    }
+    memory.stop();
+    EXPECT_EQ(memory.total_allocations(), 1u);
+    EXPECT_EQ(memory.active_allocations(), 0u);
+}
+
+TEST(const_string, make_const) {
+    shared::mutable_string str("a mutable string with spare capacity");
+    str.reserve(100);
+    auto data = str.c_str();
+    allocations_recorder memory;
+    {
+        // the buffer is adopted as it is
+        auto res = shared::make_const(std::move(str));
+        memory.stop();
+        EXPECT_STREQ(res.c_str(), "a mutable string with spare capacity");
+        EXPECT_EQ(res.c_str(), data);
+        EXPECT_STREQ(str.c_str(), "");
+        if (!SKIP_ALLOCATIONS_TEST) {
+            EXPECT_EQ(memory.total_allocations(), 0u);
+        }
+    }
+
+    // no room for the header, copied
+    shared::mutable_string full("the buffer is exactly as long as needed");
+    auto copied = shared::make_const(std::move(full));
+    EXPECT_STREQ(copied.c_str(), "the buffer is exactly as long as needed");
+    EXPECT_STREQ(full.c_str(), "");
+
+    shared::mutable_string small("small");
+    EXPECT_STREQ(shared::make_const(std::move(small)).c_str(), "small");
+    shared::mutable_string medium("medium sized string");
+    EXPECT_STREQ(shared::make_const(std::move(medium)).c_str(), "medium sized string");
+
+    auto back = shared::make_mutable(copied);
+    back.insert(0, "changed: ");
+    EXPECT_STREQ(back.c_str(), "changed: the buffer is exactly as long as needed");
+    EXPECT_STREQ(copied.c_str(), "the buffer is exactly as long as needed");
+}
+
+TEST(const_string, make_mutable) {
+    allocations_recorder memory;
+    {
+        // build, freeze, thaw, edit and freeze again in one buffer
+        shared::mutable_string str;
+        str.reserve(100);
+        str.insert(0, "a string built in place");
+        auto data = str.c_str();
+        auto frozen = shared::make_const(std::move(str));
+        EXPECT_EQ(frozen.c_str(), data);
+        auto thawed = shared::make_mutable(std::move(frozen));
+        EXPECT_EQ(thawed.c_str(), data);
+        EXPECT_TRUE(frozen.empty());
+        EXPECT_GE(thawed.capacity(), 100u);
+        thawed.insert(thawed.size(), ", then edited");
+        EXPECT_STREQ(thawed.c_str(), "a string built in place, then edited");
+        auto refrozen = shared::make_const(std::move(thawed));
+        EXPECT_EQ(refrozen.c_str(), data);
+        EXPECT_STREQ(refrozen.c_str(), "a string built in place, then edited");
+        memory.stop();
+        if (!SKIP_ALLOCATIONS_TEST) {
+            EXPECT_EQ(memory.total_allocations(), 1u);
+        }
+    }
+
+    // shared chars are copied, the other owner keeps them
+    shared::const_string str("a string with two owners");
+    auto other = str;
+    auto copied = shared::make_mutable(std::move(str));
+    EXPECT_NE(copied.c_str(), other.c_str());
+    EXPECT_STREQ(copied.c_str(), "a string with two owners");
+    EXPECT_TRUE(str.empty());
+    EXPECT_EQ(other.use_count(), 1u);
+    auto last = shared::make_mutable(std::move(other));
+    EXPECT_STREQ(last.c_str(), "a string with two owners");
+
+    shared::const_string small("small");
+    EXPECT_STREQ(shared::make_mutable(std::move(small)).c_str(), "small");
+    EXPECT_TRUE(small.empty());
+}
+
+template <class String>
+void check_refcount() {
+    String str("shared by all the copies");
+    {
+        std::vector<String> copies(10, str);
+        EXPECT_EQ(str.use_count(), 11u);
+        copies.erase(copies.begin() + 3, copies.end());
+        EXPECT_EQ(str.use_count(), 4u);
+        String assigned;
+        assigned = copies[0];
+        EXPECT_EQ(assigned.use_count(), 5u);
+    }
+    EXPECT_EQ(str.use_count(), 1u);
+
+    auto copy = str;
+    auto thawed = shared::make_mutable(std::move(str));
+    EXPECT_NE(thawed.c_str(), copy.c_str());
+    EXPECT_EQ(copy.use_count(), 1u);
+    auto data = copy.c_str();
+    thawed = shared::make_mutable(std::move(copy));
+    EXPECT_EQ(thawed.c_str(), data);
+
+    if (SKIP_ALLOCATIONS_TEST) return;
+    allocations_recorder memory;
+    {
+        String shared("one allocation for any number of copies");
+        std::vector<String> copies;
+        copies.reserve(100);
+        for (int i = 0; i < 100; ++i) {
+            copies.push_back(shared);
+        }
+    }
+    memory.stop();
+    // the chars and the vector
+    EXPECT_EQ(memory.total_allocations(), 2u);
+    EXPECT_EQ(memory.active_allocations(), 0u);
+}
+
+TEST(const_string, refcount_policies) {
+    check_refcount<shared::local_const_string>();
+    check_refcount<shared::const_string>();
+    check_refcount<shared::biased_const_string>();
+    EXPECT_EQ(shared::make_const<shared::biased_refcount>(shared::mutable_string("made from a mutable string")),
+        shared::biased_const_string("made from a mutable string"));
+}
+
+TEST(const_string, biased_threads) {
+    const int THREADS = 4;
+    const int COPIES = 1000;
+    shared::biased_const_string str("copied by the owner and by other threads");
+    {
+        // copies made by the owner are released by other threads
+        std::vector<shared::biased_const_string> handed(THREADS, str);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) {
+            threads.emplace_back([&handed, t] {
+                auto own = std::move(handed[t]);
+                std::vector<shared::biased_const_string> copies;
+                for (int i = 0; i < COPIES; ++i) {
+                    copies.push_back(own);
+                }
+                EXPECT_GE(own.use_count(), (size_t)COPIES + 2);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    EXPECT_EQ(str.use_count(), 1u);
+
+    // the owner thread is gone before its string is released
+    shared::biased_const_string made_elsewhere;
+    std::thread([&made_elsewhere] {
+        shared::biased_const_string own("made by a thread that exits");
+        auto copy = own;
+        made_elsewhere = copy;
+    }).join();
+    EXPECT_EQ(made_elsewhere.use_count(), 1u);
+    auto copy = made_elsewhere;
+    EXPECT_EQ(made_elsewhere.use_count(), 2u);
+    EXPECT_STREQ(copy.c_str(), "made by a thread that exits");
+}
+
+TEST(const_string, slices) {
+    shared::const_string payload("name=a field long enough to share;id=42;comment=short");
+    {
+        allocations_recorder memory;
+        auto name = payload.slice(5, 28);
+        // short fields are copied to the inline form
+        auto id = payload.slice(37, 2);
+        memory.stop();
+        if (!SKIP_ALLOCATIONS_TEST) {
+            EXPECT_EQ(memory.total_allocations(), 0u);
+        }
+        EXPECT_EQ(std::string(name.begin(), name.end()), "a field long enough to share");
+        EXPECT_EQ(name.data(), payload.c_str() + 5);
+        EXPECT_EQ(payload.use_count(), 2u);
+        EXPECT_EQ(std::string(id.data(), id.size()), "42");
+        EXPECT_EQ(id.owner().use_count(), 1u);
+
+        // slices of slices share the first owner
+        auto field = name.slice(8, 100);
+        EXPECT_EQ(std::string(field.data(), field.size()), "long enough to share");
+        EXPECT_EQ(field.data(), payload.c_str() + 13);
+        EXPECT_EQ(payload.use_count(), 3u);
+        EXPECT_EQ(field, payload.slice<shared::never_share>(13, 20));
+        EXPECT_EQ(field.hash(), shared::const_string("long enough to share").hash());
+    }
+    EXPECT_EQ(payload.use_count(), 1u);
+
+    // too much waste, the slice gets own chars
+    std::string large(1000, 'x');
+    shared::const_string big(large.c_str(), large.size());
+    auto small = big.slice(100, 20);
+    EXPECT_NE(small.data(), big.c_str() + 100);
+    EXPECT_EQ(big.use_count(), 1u);
+    auto shared_small = big.slice<shared::always_share>(100, 20);
+    EXPECT_EQ(shared_small.data(), big.c_str() + 100);
+    EXPECT_EQ(small, shared_small);
+    auto copied = payload.slice<shared::never_share>(5, 28);
+    EXPECT_NE(copied.data(), payload.c_str() + 5);
+    EXPECT_EQ(copied.owner().size(), 28u);
+
+    // materialized only when it is changed
+    auto whole = payload.slice(0, 1000);
+    EXPECT_EQ(whole.to_const().c_str(), payload.c_str());
+    EXPECT_EQ(shared_small.to_const(), shared::const_string(large.c_str(), 20));
+    auto edited = shared::make_mutable(shared_small);
+    edited.insert(0, ">");
+    EXPECT_EQ(edited.size(), 21u);
+    EXPECT_EQ(big.c_str()[100], 'x');
+    auto data = big.c_str();
+    auto all = big.slice(0, big.size());
+    big = shared::const_string();
+    shared_small = shared::string_slice();
+    auto thawed = shared::make_mutable(std::move(all));
+    EXPECT_EQ(thawed.c_str(), data);
+    EXPECT_TRUE(all.empty());
+    EXPECT_EQ(thawed.size(), 1000u);
+}
+
+TEST(dedup, records) {
+    const char* values[] = { "DE", "Berlin, Brandenburg and around", "Hamburg and the north sea coast", "FR" };
+    dedup::table<> table;
+    std::vector<dedup::value> fields;
+    for (int i = 0; i < 100; ++i) {
+        fields.push_back(table.add(sso4::string(values[i % 4])));
+    }
+    EXPECT_EQ(table.size(), 2u);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_STREQ(fields[i].c_str(), values[i % 4]);
+        if (i % 4 == 1 || i % 4 == 2) {
+            EXPECT_EQ(fields[i].c_str(), fields[i % 4].c_str());
+        }
+    }
+    // table and 25 fields for each long value
+    EXPECT_EQ(fields[1].use_count(), 26u);
+    EXPECT_EQ(fields[0].use_count(), 1u);
+
+    auto& report = table.report();
+    EXPECT_EQ(report.strings, 100u);
+    EXPECT_EQ(report.inline_strings, 50u);
+    EXPECT_EQ(report.bytes, 25u * (std::strlen(values[1]) + std::strlen(values[2])));
+    EXPECT_EQ(report.unique_bytes, std::strlen(values[1]) + std::strlen(values[2]));
+    EXPECT_DOUBLE_EQ(report.ratio(), 25.0);
+
+    // a new value keeps its buffer, duplicates leave theirs
+    shared::mutable_string loaded("a value read into a buffer with room");
+    loaded.reserve(100);
+    auto data = loaded.c_str();
+    auto kept = table.add(std::move(loaded));
+    EXPECT_EQ(kept.c_str(), data);
+    EXPECT_EQ(loaded.size(), 0u);
+    EXPECT_EQ(table.add(shared::mutable_string("a value read into a buffer with room")).c_str(), data);
+    EXPECT_EQ(table.add(data, std::strlen(data)).c_str(), data);
+    EXPECT_EQ(table.size(), 3u);
+
+    table.clear();
+    EXPECT_EQ(table.size(), 0u);
+    EXPECT_EQ(table.report().strings, 0u);
+    EXPECT_STREQ(kept.c_str(), "a value read into a buffer with room");
+    EXPECT_EQ(kept.use_count(), 1u);
+}
+
+TEST(dedup, inline_values) {
+    // values up to the inline capacity of sso4::string never enter the table
+    const char* values[] = { "", "Berlin", "Berlin-Brandenburg", "Rheinland-Pfalz/Saarl", "Mecklenburg-Vorpommern" };
+    dedup::table<> table;
+    allocations_recorder memory;
+    {
+        for (auto value : values) {
+            auto res = table.add(sso4::string(value));
+            EXPECT_TRUE(res.is_inline());
+            EXPECT_STREQ(res.c_str(), value);
+            EXPECT_EQ(res.size(), std::strlen(value));
+            EXPECT_EQ(res.hash(), hashing::hash32(value, std::strlen(value)));
+            EXPECT_EQ(res.use_count(), 1u);
+            EXPECT_TRUE(res.shared().empty());
+            EXPECT_EQ(res, table.add(value, std::strlen(value)));
+        }
+    }
+    memory.stop();
+    if (!SKIP_ALLOCATIONS_TEST) {
+        EXPECT_EQ(memory.total_allocations(), 0u);
+    }
+    EXPECT_EQ(table.size(), 0u);
+    EXPECT_EQ(table.report().inline_strings, 10u);
+    EXPECT_EQ(table.report().bytes, 0u);
+
+    auto longer = table.add(sso4::string("Nordrhein-Westfalen (NRW)"));
+    EXPECT_FALSE(longer.is_inline());
+    EXPECT_EQ(longer.use_count(), 2u);
+    EXPECT_EQ(table.size(), 1u);
+}
+
+TEST(dedup, budget) {
+    dedup::table<shared::local_refcount> table(40);
+    auto first = table.add(sso3::string("the first value fits the budget"));
+    auto second = table.add(sso3::string("the second value does not fit it"));
+    EXPECT_EQ(table.size(), 1u);
+    EXPECT_EQ(table.add(sso3::string("the first value fits the budget")).c_str(), first.c_str());
+    auto again = table.add(sso3::string("the second value does not fit it"));
+    EXPECT_NE(again.c_str(), second.c_str());
+    EXPECT_EQ(again, second);
+    EXPECT_EQ(second.use_count(), 1u);
+
+    auto& report = table.report();
+    EXPECT_EQ(report.unique_bytes, 31u);
+    EXPECT_EQ(report.unshared_bytes, 64u);
+    EXPECT_DOUBLE_EQ(report.ratio(), 126.0 / 95.0);
+    EXPECT_DOUBLE_EQ(dedup::table<>().report().ratio(), 1.0);
+}
+
+constexpr keywords::key HTTP_METHODS[] = {
+    "GET", "HEAD", "POST", "PUT", "DELETE", "CONNECT", "OPTIONS", "TRACE", "PATCH"
+};
+constexpr keywords::table<9> HTTP_METHODS_TABLE(HTTP_METHODS);
+static_assert(HTTP_METHODS_TABLE.find("POST", 4) == 2, "keywords::table is not constexpr");
+static_assert(HTTP_METHODS_TABLE.find("POS", 3) == keywords::npos, "keywords::table is not constexpr");
+
+constexpr keywords::key HTTP_HEADERS[] = {
+    "accept", "accept-charset", "accept-encoding", "accept-language", "accept-ranges", "age",
+    "allow", "authorization", "cache-control", "connection", "content-encoding",
+    "content-language", "content-length", "content-location", "content-range", "content-type",
+    "cookie", "date", "etag", "expect", "expires", "from", "host", "if-match", "if-modified-since",
+    "if-none-match", "if-range", "if-unmodified-since", "last-modified", "location",
+    "max-forwards", "pragma", "proxy-authenticate", "proxy-authorization", "range", "referer",
+    "retry-after", "server", "set-cookie", "te", "trailer", "transfer-encoding", "upgrade",
+    "user-agent", "vary", "via", "warning", "www-authenticate"
+};
+
+TEST(keywords, table) {
+    for (size_t i = 0; i < sizeof(HTTP_METHODS) / sizeof(HTTP_METHODS[0]); ++i) {
+        EXPECT_EQ(HTTP_METHODS_TABLE.find(sso4::string(HTTP_METHODS[i].data)), i);
+        EXPECT_EQ(HTTP_METHODS_TABLE.find(sso3::string(HTTP_METHODS[i].data)), i);
+        EXPECT_STREQ(HTTP_METHODS_TABLE[i].data, HTTP_METHODS[i].data);
+    }
+    const char* misses[] = { "", "get", "GETS", "GE", "POSTPOSTPOSTPOSTPOSTPOSTPOST", "PATCHES", "OPTION" };
+    for (auto miss : misses) {
+        EXPECT_FALSE(HTTP_METHODS_TABLE.contains(miss, std::strlen(miss)));
+    }
+    // a view into a larger text
+    const char* request = "DELETE /index.html";
+    EXPECT_EQ(HTTP_METHODS_TABLE.find(request, 6), 4u);
+
+    constexpr auto headers = keywords::make_table(HTTP_HEADERS);
+    EXPECT_EQ(headers.size(), sizeof(HTTP_HEADERS) / sizeof(HTTP_HEADERS[0]));
+    for (size_t i = 0; i < headers.size(); ++i) {
+        std::string header = HTTP_HEADERS[i].data;
+        EXPECT_EQ(headers.find(header.c_str(), header.size()), i);
+        header.pop_back();
+        EXPECT_NE(headers.find(header.c_str(), header.size()), i);
+        header += "xx";
+        EXPECT_EQ(headers.find(header.c_str(), header.size()), keywords::npos);
+    }
+}
+
+TEST(keywords, runtime_keys) {
+    // the same construction works at run time for keys known late
+    std::vector<std::string> names;
+    for (int i = 0; i < 1000; ++i) {
+        names.push_back("key " + std::to_string(i * 7919));
+    }
+    keywords::key keys[1000];
+    for (size_t i = 0; i < names.size(); ++i) {
+        keys[i] = keywords::key(names[i].c_str(), names[i].size());
+    }
+    std::unique_ptr<keywords::table<1000>> table(new keywords::table<1000>(keys));
+    for (size_t i = 0; i < names.size(); ++i) {
+        EXPECT_EQ(table->find(names[i].c_str(), names[i].size()), i);
+        auto miss = "key " + std::to_string(i * 7919 + 1);
+        EXPECT_EQ(table->find(miss.c_str(), miss.size()), keywords::npos);
+    }
+
+    keywords::key duplicates[] = { "same", "other", "same" };
+    try {
+        keywords::table<3> bad(duplicates);
+        ADD_FAILURE() << "duplicate keys are accepted";
+    }
+    catch (const std::logic_error& e) {
+        EXPECT_NE(std::string(e.what()).find("duplicate"), std::string::npos);
+    }
+}
+
+// keys of the same size collide with seed 0
+struct size_hash {
+    static constexpr uint64_t hash(const char* str, size_t size, uint64_t seed) noexcept {
+        return seed == 0 ? size : keywords::hash(str, size, seed);
+    }
+};
+
+constexpr keywords::key SAME_SIZE_KEYS[] = { "abc", "abd", "xyz", "ab" };
+constexpr keywords::table<4, size_hash> SAME_SIZE_TABLE(SAME_SIZE_KEYS);
+static_assert(SAME_SIZE_TABLE.find("abd", 3) == 1, "keywords::table doesn't rehash collisions");
+
+TEST(keywords, colliding_hashes) {
+    // distinct keys with equal hashes are placed with another seed, not reported as duplicates
+    for (size_t i = 0; i < SAME_SIZE_TABLE.size(); ++i) {
+        EXPECT_EQ(SAME_SIZE_TABLE.find(SAME_SIZE_KEYS[i].data, SAME_SIZE_KEYS[i].size), i);
+    }
+    EXPECT_EQ(SAME_SIZE_TABLE.find("abe", 3), keywords::npos);
+
+    keywords::key duplicates[] = { "abc", "abd", "abc" };
+    EXPECT_THROW((keywords::table<3, size_hash>(duplicates)), std::logic_error);
+}
+
+TEST(interning, symbols) {
+    interning::table table;
+    interning::cache cache(table);
+    auto abc = cache.intern(interning::make_key(sso4::string("abc")));
+    EXPECT_EQ(cache.intern(interning::make_key(sso3::string("abc"))), abc);
+    EXPECT_EQ(cache.intern(interning::make_key(simple::string("abc"))), abc);
+    EXPECT_EQ(table.intern(interning::make_key("abc", 3)), abc);
+    EXPECT_NE(cache.intern(interning::make_key("abd", 3)), abc);
+    EXPECT_STREQ(table.c_str(abc), "abc");
+    EXPECT_EQ(table.size(abc), 3u);
+    EXPECT_EQ(cache.intern(interning::make_key("", 0)), interning::symbol());
+    EXPECT_EQ(cache.hits(), 2u);
+
+    // cached hash of a long string is the one the table uses
+    sso4::string long_string("a string long enough to live on the heap");
+    long_string.hash();
+    auto long_symbol = cache.intern(interning::make_key(long_string));
+    EXPECT_EQ(table.hash(long_symbol), hashing::hash32(long_string.c_str(), long_string.size()));
+    EXPECT_EQ(cache.intern(interning::make_key(sso3::string(long_string.c_str()))), long_symbol);
+
+    // many segments and chunks, chars never move
+    std::vector<interning::symbol> symbols;
+    std::string huge(100000, 'x');
+    symbols.push_back(cache.intern(interning::make_key(huge.c_str(), huge.size())));
+    for (int i = 0; i < 5000; ++i) {
+        auto str = std::to_string(i);
+        symbols.push_back(cache.intern(interning::make_key(str.c_str(), str.size())));
+    }
+    EXPECT_EQ(table.symbol_count(), 5005u);
+    EXPECT_EQ(table.c_str(symbols[0]), table.c_str(cache.intern(interning::make_key(huge.c_str(), huge.size()))));
+    for (int i = 0; i < 5000; ++i) {
+        auto str = std::to_string(i);
+        EXPECT_EQ(table.intern(interning::make_key(str.c_str(), str.size())), symbols[i + 1]);
+        EXPECT_STREQ(table.c_str(symbols[i + 1]), str.c_str());
+    }
+    EXPECT_GT(table.memory_usage(), huge.size() + 5000 * 5);
+}
+
+TEST(interning, bulk) {
+    std::vector<sso4::string> values;
+    const char* codes[] = { "DE", "FR", "a country code that is not short", "US", "" };
+    for (int i = 0; i < 100; ++i) {
+        values.push_back(sso4::string(codes[i * 7 % 5]));
+    }
+    auto symbols = interning::intern_all(values);
+    ASSERT_EQ(symbols.size(), values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_STREQ(interning::c_str(symbols[i]), values[i].c_str());
+        EXPECT_EQ(interning::size(symbols[i]), values[i].size());
+        EXPECT_EQ(symbols[i], interning::intern(values[i]));
+        for (size_t j = 0; j < i; ++j) {
+            EXPECT_EQ(symbols[i] == symbols[j], values[i] == values[j]);
+        }
+    }
+    EXPECT_EQ(interning::intern("", 0), interning::symbol());
+}
+
+TEST(interning, threads) {
+    const int THREADS = 4;
+    const int COUNT = 2000;
+    std::vector<std::vector<interning::symbol>> results(THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([t, &results] {
+            auto& res = results[t];
+            res.resize(COUNT);
+            // different orders, every thread adds some of the strings first
+            for (int n = 0; n < COUNT; ++n) {
+                auto i = (n * 7 + t * 500) % COUNT;
+                auto str = "threads " + std::to_string(i);
+                res[i] = interning::intern(str.c_str(), str.size());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int i = 0; i < COUNT; ++i) {
+        auto str = "threads " + std::to_string(i);
+        EXPECT_STREQ(interning::c_str(results[0][i]), str.c_str());
+        for (int t = 1; t < THREADS; ++t) {
+            EXPECT_EQ(results[t][i], results[0][i]);
+        }
+    }
+}
+
+// table of shared strings that counts live versions
+struct versioned_values {
+    static std::atomic<int> live;
+    int version;
+    std::vector<shared::local_const_string> values;
+
+    explicit versioned_values(int version) : version(version) {
+        ++live;
+        for (int i = 0; i < 8; ++i) {
+            auto value = "value " + std::to_string(i) + " of version " + std::to_string(version);
+            values.push_back(shared::local_const_string(value.c_str(), value.size()));
+        }
+    }
+    ~versioned_values() {
+        --live;
+    }
+    // every value belongs to the same version
+    bool consistent() const {
+        auto suffix = " of version " + std::to_string(version);
+        for (auto& value : values) {
+            if (value.size() < suffix.size()
+                || std::memcmp(value.c_str() + value.size() - suffix.size(), suffix.data(), suffix.size()) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+std::atomic<int> versioned_values::live(0);
+
+TEST(epochs, retire) {
+    {
+        epochs::domain domain;
+        epochs::reader reader(domain);
+        epochs::atomic_ptr<versioned_values> table(std::unique_ptr<versioned_values>(new versioned_values(0)), domain);
+        {
+            epochs::guard guard(reader);
+            auto old = table.load(guard);
+            table.store(std::unique_ptr<versioned_values>(new versioned_values(1)));
+            {
+                epochs::guard nested(reader);
+            }
+            // the reader may still use the old version
+            EXPECT_EQ(domain.collect(), 0u);
+            EXPECT_EQ(domain.pending(), 1u);
+            EXPECT_STREQ(old->values[7].c_str(), "value 7 of version 0");
+        }
+        EXPECT_EQ(domain.collect(), 1u);
+        EXPECT_EQ(versioned_values::live.load(), 1);
+
+        // readers entering after the swap don't hold the old version back
+        table.store(std::unique_ptr<versioned_values>(new versioned_values(2)));
+        {
+            epochs::guard guard(reader);
+            EXPECT_EQ(domain.collect(), 1u);
+            EXPECT_EQ(table.load(guard)->version, 2);
+        }
+        table.store(std::unique_ptr<versioned_values>(new versioned_values(3)));
+        EXPECT_EQ(domain.pending(), 1u);
+    }
+    // the table retires its last version and the domain deletes what is left
+    EXPECT_EQ(versioned_values::live.load(), 0);
+}
+
+TEST(epochs, threads) {
+    {
+        epochs::domain domain;
+        epochs::atomic_ptr<versioned_values> table(std::unique_ptr<versioned_values>(new versioned_values(0)), domain);
+        std::atomic<bool> stop(false);
+        std::atomic<int> inconsistent(0);
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.emplace_back([&] {
+                epochs::reader reader(domain);
+                while (!stop.load(std::memory_order_relaxed)) {
+                    epochs::guard guard(reader);
+                    if (!table.load(guard)->consistent()) ++inconsistent;
+                }
+            });
+        }
+        for (int version = 1; version <= 500; ++version) {
+            table.store(std::unique_ptr<versioned_values>(new versioned_values(version)));
+        }
+        stop.store(true);
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        domain.synchronize();
+        EXPECT_EQ(inconsistent.load(), 0);
+        EXPECT_EQ(domain.pending(), 0u);
+        EXPECT_EQ(versioned_values::live.load(), 1);
+    }
+    EXPECT_EQ(versioned_values::live.load(), 0);
+
+    // the global domain with a reader per thread
+    epochs::atomic_ptr<versioned_values> table(std::unique_ptr<versioned_values>(new versioned_values(0)));
+    std::thread([&] {
+        epochs::guard guard;
+        EXPECT_TRUE(table.load(guard)->consistent());
+    }).join();
+    table.store(std::unique_ptr<versioned_values>(new versioned_values(1)));
+    epochs::global_domain().synchronize();
+    EXPECT_EQ(versioned_values::live.load(), 1);
+}
+
+TEST(kernels, move) {
+    char source[256];
+    for (size_t i = 0; i < sizeof(source); ++i) {
+        source[i] = (char)(i * 7 + 1);
+    }
+    for (size_t count = 0; count <= 2 * kernels::SMALL_SIZE; ++count) {
+        for (int shift = -3; shift <= 3; ++shift) {
+            char expected[256];
+            char actual[256];
+            std::memcpy(expected, source, sizeof(source));
+            std::memcpy(actual, source, sizeof(source));
+            std::memmove(expected + 64 + shift, expected + 64, count);
+            kernels::move(actual + 64 + shift, actual + 64, count);
+            EXPECT_EQ(std::memcmp(expected, actual, sizeof(source)), 0) << count << " " << shift;
+        }
+    }
+}
+
+TEST(kernels, fill) {
+    for (size_t count = 0; count <= 2 * kernels::SMALL_SIZE; ++count) {
+        char expected[256];
+        char actual[256];
+        std::memset(expected, '.', sizeof(expected));
+        std::memset(actual, '.', sizeof(actual));
+        std::memset(expected + 3, 'x', count);
+        kernels::fill(actual + 3, 'x', count);
+        EXPECT_EQ(std::memcmp(expected, actual, sizeof(actual)), 0) << count;
+    }
+}
+
+TEST(kernels, fill_inline) {
+    for (size_t count = 0; count < 32; ++count) {
+        char expected[40];
+        char actual[40];
+        std::memset(expected, '.', sizeof(expected));
+        std::memset(actual, '.', sizeof(actual));
+        std::memset(expected + 3, 'x', count);
+        kernels::fill_inline(actual + 3, 'x', count);
+        EXPECT_EQ(std::memcmp(expected, actual, sizeof(actual)), 0) << count;
+    }
+}
+
+TEST(gap_string, insert_at_cursor) {
+    gap::string str("hello world");
+    str.insert(5, ",");
+    str.insert(6, "");
+    str.insert(7, "big ");
+    str.insert(11, 3, '!');
+    EXPECT_EQ(str.size(), 19u);
+    EXPECT_STREQ(str.c_str(), "hello, big !!!world");
+    str.insert(0, ">");
+    str.insert(str.size(), "<");
+    EXPECT_STREQ(str.c_str(), ">hello, big !!!world<");
+    EXPECT_EQ(std::string(str.begin(), str.end()), ">hello, big !!!world<");
+}
+
+TEST(gap_string, insert_random_positions) {
+    gap::string str;
+    std::string expected;
+    size_t seed = 12345;
+    for (int i = 0; i < 1000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        auto index = (seed >> 16) % (expected.size() + 1);
+        char text[] = { char('a' + i % 26), char('A' + i % 26), 0 };
+        str.insert(index, text);
+        expected.insert(index, text);
+        if (i % 100 == 0) {
+            EXPECT_STREQ(str.c_str(), expected.c_str());
+        }
+    }
+    EXPECT_EQ(str.size(), expected.size());
+    EXPECT_STREQ(str.c_str(), expected.c_str());
+}
+
+TEST(gap_string, insert_self) {
+    gap::string str("01234");
+    str.reserve(16);
+    str.insert(3, str.c_str() + 1);
+    EXPECT_STREQ(str.c_str(), "012123434");
+    str.insert(1, str.c_str() + 6);
+    EXPECT_STREQ(str.c_str(), "043412123434");
+}
+
+TEST(gap_string, resize) {
+    gap::string str("0123456789");
+    str.insert(3, "abc");
+    str.resize(8);
+    EXPECT_STREQ(str.c_str(), "012abc34");
+    str.insert(2, "x");
+    str.resize(2);
+    EXPECT_STREQ(str.c_str(), "01");
+    str.resize(5, 'z');
+    EXPECT_STREQ(str.c_str(), "01zzz");
+    EXPECT_EQ(str.size(), 5u);
+}
+
+TEST(gap_string, sequential_insert_allocations) {
+    if (SKIP_ALLOCATIONS_TEST) return;
+
+    gap::string str("loooooooooooooooooooooong string");
+    allocations_recorder memory;
+    for (int i = 0; i < 1000; ++i) {
+        str.insert(16, "a");
+    }
+    memory.stop();
+    // capacity grows over powers of two
+    EXPECT_LE(memory.total_allocations(), 6u);
+    EXPECT_EQ(str.size(), 1032u);
+}
+
+std::string to_std_string(const rope::string& str) {
+    std::string res;
+    for (auto chunk : str.chunks()) {
+        res.append(chunk.data, chunk.size);
+    }
+    return res;
+}
+
+TEST(rope_string, insert_erase) {
+    rope::string str("hello world");
+    str.insert(5, ",");
+    str.insert(7, "big ");
+    str.insert(11, 3, '!');
+    str.insert(0, "");
+    EXPECT_EQ(str.size(), 19u);
+    EXPECT_EQ(to_std_string(str), "hello, big !!!world");
+    str.erase(5, 9);
+    EXPECT_EQ(to_std_string(str), "helloworld");
+    str.erase(0, 5);
+    str.erase(str.size(), 0);
+    EXPECT_EQ(to_std_string(str), "world");
+    str.erase(0, str.size());
+    EXPECT_EQ(str.size(), 0u);
+    EXPECT_TRUE(str.chunks().begin() == str.chunks().end());
+}
+
+TEST(rope_string, random_edits) {
+    rope::string str;
+    std::string expected;
+    size_t seed = 12345;
+    for (int i = 0; i < 2000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        auto index = (seed >> 16) % (expected.size() + 1);
+        if (i % 3 == 2) {
+            auto count = (seed >> 8) % 8;
+            str.erase(index, count);
+            expected.erase(index, count);
+        }
+        else {
+            char text[] = { char('a' + i % 26), char('A' + i % 26), 0 };
+            str.insert(index, text);
+            expected.insert(index, text);
+        }
+    }
+    EXPECT_EQ(str.size(), expected.size());
+    EXPECT_EQ(to_std_string(str), expected);
+}
+
+TEST(rope_string, views_and_substr) {
+    sso3::string hello("hello, loooooooooooooooooooooong");
+    rope::string str;
+    str.insert_view(0, hello);
+    str.insert_view(str.size(), " world", 6);
+    EXPECT_EQ(str.chunks().begin().operator*().data, hello.c_str());
+
+    std::string expected = "hello, loooooooooooooooooooooong world";
+    EXPECT_EQ(to_std_string(str), expected);
+
+    auto sub = str.substr(7, 30);
+    EXPECT_EQ(to_std_string(sub), expected.substr(7, 30));
+    EXPECT_EQ(sub.chunks().begin().operator*().data, hello.c_str() + 7);
+    EXPECT_EQ(to_std_string(str.substr(10, 1000)), expected.substr(10));
+
+    sub.insert(4, str);
+    EXPECT_EQ(to_std_string(sub), expected.substr(7, 4) + expected + expected.substr(11, 26));
+    str.insert(0, str);
+    EXPECT_EQ(to_std_string(str), expected + expected);
+}
+
+TEST(rope_string, flatten) {
+    rope::string str("0123456789");
+    str.insert(5, "abc");
+    rope::string copy(str);
+    str.erase(0, 5);
+    EXPECT_STREQ(copy.flatten().c_str(), "01234abc56789");
+    EXPECT_STREQ(str.flatten().c_str(), "abc56789");
+    EXPECT_STREQ(rope::string().flatten().c_str(), "");
+}
+
+TEST(rope_string, flatten_allocations) {
+    if (SKIP_ALLOCATIONS_TEST) return;
+
+    rope::string str;
+    for (int i = 0; i < 100; ++i) {
+        str.insert(str.size() / 2, "some text ");
+    }
+    allocations_recorder memory;
+    {
+        auto flat = str.flatten();
+        EXPECT_EQ(flat.size(), 1000u);
+    }
+    memory.stop();
+    EXPECT_EQ(memory.total_allocations(), 1u);
+}
+
 #if 0
 TEST(sso4_string, small_buffer_size_22) {
     if (!has_sso) return;
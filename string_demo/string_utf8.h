@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "string_kernels.h"
+
+// UTF-8 validation and code point counting.
+// Both skip ASCII 16 chars at a time, the rest of the text is validated
+// 32 chars at a time with the lookup table algorithm (Keiser, Lemire,
+// "Validating UTF-8 In Less Than One Instruction Per Byte") if CPU has AVX2.
+// It looks up the high and low nibbles of every pair of adjacent chars in three
+// 16-entry tables, each table entry is a set of errors the nibble allows,
+// so a pair is bad if all three lookups share an error bit.
+// SSE2 has no byte shuffle for the lookups, without AVX2 non-ASCII chars
+// are checked one code point at a time.
+namespace utf8 {
+
+    // true if all chars are below 0x80
+    inline bool is_ascii(const char* str, size_t size) {
+        size_t i = 0;
+#if HAS_SSE2
+        for (; i + 16 <= size; i += 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+            if (_mm_movemask_epi8(block) != 0) return false;
+        }
+#endif
+        for (; i + 8 <= size; i += 8) {
+            if (kernels::load8(str + i) & 0x8080808080808080ull) return false;
+        }
+        for (; i < size; ++i) {
+            if (str[i] & 0x80) return false;
+        }
+        return true;
+    }
+
+    // position of the first non-ASCII char at or after from or size
+    inline size_t skip_ascii(const char* str, size_t size, size_t from) {
+#if HAS_SSE2
+        for (; from + 16 <= size; from += 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + from));
+            if (_mm_movemask_epi8(block) != 0) break;
+        }
+#endif
+        while (from < size && (unsigned char)str[from] < 0x80) ++from;
+        return from;
+    }
+
+    inline bool is_continuation(unsigned char ch) {
+        return (ch & 0xC0) == 0x80;
+    }
+
+    // checks lead chars and ranges of second chars from Unicode table 3-7
+    inline bool validate_scalar(const char* str, size_t size) {
+        auto ptr = reinterpret_cast<const unsigned char*>(str);
+        size_t i = 0;
+        while (true) {
+            i = skip_ascii(str, size, i);
+            if (i == size) return true;
+            auto lead = ptr[i];
+            size_t length;
+            unsigned char min = 0x80, max = 0xBF;
+            if (lead < 0xC2) {
+                return false;
+            }
+            else if (lead < 0xE0) {
+                length = 2;
+            }
+            else if (lead < 0xF0) {
+                length = 3;
+                if (lead == 0xE0) min = 0xA0;   // overlong
+                if (lead == 0xED) max = 0x9F;   // surrogates
+            }
+            else if (lead < 0xF5) {
+                length = 4;
+                if (lead == 0xF0) min = 0x90;   // overlong
+                if (lead == 0xF4) max = 0x8F;   // above U+10FFFF
+            }
+            else {
+                return false;
+            }
+            if (size - i < length) return false;
+            if (ptr[i + 1] < min || ptr[i + 1] > max) return false;
+            for (size_t k = 2; k < length; ++k) {
+                if (!is_continuation(ptr[i + k])) return false;
+            }
+            i += length;
+        }
+    }
+
+#if HAS_AVX2_DISPATCH
+    // error bits of a pair of adjacent chars
+    enum : uint8_t {
+        TOO_SHORT = 1 << 0,     // 11______ 0_______ or 11______ 11______
+        TOO_LONG = 1 << 1,      // 0_______ 10______
+        OVERLONG_3 = 1 << 2,    // 11100000 100_____
+        TOO_LARGE = 1 << 3,     // 11110100 1001____ and bigger
+        SURROGATE = 1 << 4,     // 11101101 101_____
+        OVERLONG_2 = 1 << 5,    // 1100000_ 10______
+        TOO_LARGE_1000 = 1 << 6,// 11110101 1000____ and bigger
+        OVERLONG_4 = 1 << 6,    // 11110000 1000____
+        TWO_CONTS = 1 << 7,     // 10______ 10______
+        CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS
+    };
+
+    TARGET_AVX2 inline __m256i table16(uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3,
+        uint8_t a4, uint8_t a5, uint8_t a6, uint8_t a7, uint8_t a8, uint8_t a9, uint8_t a10,
+        uint8_t a11, uint8_t a12, uint8_t a13, uint8_t a14, uint8_t a15) {
+        return _mm256_setr_epi8(
+            a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15,
+            a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15);
+    }
+
+    // input shifted by n chars, the first chars come from the end of prev
+    template <int N>
+    TARGET_AVX2 inline __m256i prev_chars(__m256i input, __m256i prev) {
+        return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+    }
+
+    TARGET_AVX2 inline __m256i high_nibbles(__m256i input) {
+        return _mm256_and_si256(_mm256_srli_epi16(input, 4), _mm256_set1_epi8(0x0F));
+    }
+
+    struct avx2_validator {
+        __m256i error;
+        __m256i prev_input;
+        __m256i prev_incomplete;
+
+        TARGET_AVX2 avx2_validator() {
+            error = _mm256_setzero_si256();
+            prev_input = _mm256_setzero_si256();
+            prev_incomplete = _mm256_setzero_si256();
+        }
+
+        TARGET_AVX2 void check_block(__m256i input) {
+            if (_mm256_movemask_epi8(input) == 0) {
+                // ASCII block can only be wrong if previous one ended in the middle of a code point
+                error = _mm256_or_si256(error, prev_incomplete);
+            }
+            else {
+                auto prev1 = prev_chars<1>(input, prev_input);
+                auto byte_1_high = _mm256_shuffle_epi8(table16(
+                    // 0_______ ________
+                    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+                    // 10______ ________
+                    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+                    // 1100____ ________
+                    TOO_SHORT | OVERLONG_2,
+                    // 1101____ ________
+                    TOO_SHORT,
+                    // 1110____ ________
+                    TOO_SHORT | OVERLONG_3 | SURROGATE,
+                    // 1111____ ________
+                    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4), high_nibbles(prev1));
+                auto byte_1_low = _mm256_shuffle_epi8(table16(
+                    // ____0000 ________
+                    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+                    // ____0001 ________
+                    CARRY | OVERLONG_2,
+                    // ____001_ ________
+                    CARRY, CARRY,
+                    // ____0100 ________
+                    CARRY | TOO_LARGE,
+                    // ____0101 ________ and above
+                    CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+                    CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+                    CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+                    CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+                    // ____1101 ________
+                    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+                    CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000),
+                    _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)));
+                auto byte_2_high = _mm256_shuffle_epi8(table16(
+                    // ________ 0_______
+                    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+                    // ________ 1000____
+                    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+                    // ________ 1001____
+                    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+                    // ________ 101_____
+                    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+                    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+                    // ________ 11______
+                    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT), high_nibbles(input));
+                auto special_cases = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+                // third and fourth chars of a code point must be continuations, two continuations
+                // in a row are an error only if they are not
+                auto prev2 = prev_chars<2>(input, prev_input);
+                auto prev3 = prev_chars<3>(input, prev_input);
+                auto is_third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+                auto is_fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+                auto must_be_continuation = _mm256_and_si256(_mm256_or_si256(is_third, is_fourth), _mm256_set1_epi8((char)0x80));
+                error = _mm256_or_si256(error, _mm256_xor_si256(must_be_continuation, special_cases));
+
+                // lead chars in the last 3 positions that need more chars
+                const auto max_value = _mm256_setr_epi8(
+                    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                    (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+                prev_incomplete = _mm256_subs_epu8(input, max_value);
+            }
+            prev_input = input;
+        }
+
+        TARGET_AVX2 bool finish() {
+            error = _mm256_or_si256(error, prev_incomplete);
+            return _mm256_testz_si256(error, error) != 0;
+        }
+    };
+
+    TARGET_AVX2 inline bool validate_avx2(const char* str, size_t size) {
+        avx2_validator validator;
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            validator.check_block(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i)));
+        }
+        if (i < size) {
+            // zeros after the end are ASCII, code point cut by the end is still found
+            char tail[32] = {};
+            std::memcpy(tail, str + i, size - i);
+            validator.check_block(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail)));
+        }
+        return validator.finish();
+    }
+#endif
+
+    // true if chars are a well-formed UTF-8 text
+    inline bool validate(const char* str, size_t size) {
+        auto from = skip_ascii(str, size, 0);
+        if (from == size) return true;
+#if HAS_AVX2_DISPATCH
+        static const bool use_avx2 = kernels::cpu_has_avx2();
+        if (use_avx2 && size - from >= 32) {
+            // chars before from are ASCII just like zeros of the initial previous block
+            return validate_avx2(str + from, size - from);
+        }
+#endif
+        return validate_scalar(str + from, size - from);
+    }
+
+    // number of chars that are not continuations,
+    // the number of code points for a valid text
+    inline size_t count_code_points(const char* str, size_t size) {
+        size_t res = 0;
+        size_t i = 0;
+#if HAS_SSE2
+        // continuations are [-128, -65] as signed, each block adds 1 to byte counters
+        // for other chars, counters are summed before they can overflow
+        const auto last_continuation = _mm_set1_epi8(-65);
+        while (i + 16 <= size) {
+            auto counters = _mm_setzero_si128();
+            for (size_t blocks = 0; blocks < 255 && i + 16 <= size; ++blocks, i += 16) {
+                auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+                counters = _mm_sub_epi8(counters, _mm_cmpgt_epi8(block, last_continuation));
+            }
+            auto sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+            res += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+        }
+#endif
+        for (; i < size; ++i) {
+            res += !is_continuation((unsigned char)str[i]);
+        }
+        return res;
+    }
+}